@@ -1,4 +1,4 @@
-QT += core gui widgets printsupport
+QT += core gui widgets printsupport concurrent
 QMAKE_PROJECT_DEPTH = 0
 
 TARGET = axialpsfanalyzerextension
@@ -29,9 +29,22 @@ DEFINES += \
 	QT_DEPRECATED_WARNINGS #emit warnings if depracted Qt features are used
 
 SOURCES += \
+	src/columnprefixsum.cpp \
+	src/columnprojection.cpp \
+	src/columnsum.cpp \
+	src/framering.cpp \
 	src/gaussfit.cpp \
 	src/gaussfunction.cpp \
+	src/halfmaximumwidth.cpp \
+	src/lateralprofilefit.cpp \
+	src/peakfinder.cpp \
 	src/peakfit.cpp \
+	src/psfmodelregistry.cpp \
+	src/quadraticfit.cpp \
+	src/robustweights.cpp \
+	src/roifingerprint.cpp \
+	src/sincupsampler.cpp \
+	src/temporalaverage.cpp \
 	src/thirdparty/qcustomplot/qcustomplot.cpp \
 	src/axialpsfanalyzer.cpp \
 	src/axialpsfanalyzerform.cpp \
@@ -43,10 +56,30 @@ SOURCES += \
 	src/overlayitems/rectoverlay.cpp
 
 HEADERS += \
+	src/columnprefixsum.h \
+	src/columnprojection.h \
+	src/columnsum.h \
+	src/fitquality.h \
+	src/fitresult.h \
+	src/framering.h \
 	src/optimizationfunctor.h \
 	src/gaussfit.h \
 	src/gaussfunction.h \
+	src/halfmaximumwidth.h \
+	src/lateralprofilefit.h \
+	src/levenbergmarquardt.h \
+	src/peakfinder.h \
 	src/peakfit.h \
+	src/pixeltype.h \
+	src/psfmodel.h \
+	src/psfmodelfit.h \
+	src/psfmultipeakfit.h \
+	src/psfmodelregistry.h \
+	src/quadraticfit.h \
+	src/robustweights.h \
+	src/roifingerprint.h \
+	src/sincupsampler.h \
+	src/temporalaverage.h \
 	src/thirdparty/qcustomplot/qcustomplot.h \
 	src/axialpsfanalyzer.h \
 	src/axialpsfanalyzerform.h \
@@ -13,12 +13,20 @@ AxialPsfAnalyzer::AxialPsfAnalyzer()
 	isCalculating(false),
 	singleFetch(false),
 	autoFetch(true),
-	copyBufferId(-1),
-	bytesPerFrameRaw(0),
-	bytesPerFrameProcessed(0),
-	lostBuffersProcessed(0)
+	frameRing(new FrameRing()),
+	ingestMode(ROI_ONLY),
+	fusedReductionPossible(1),
+	sampleFormat(UNSIGNED_INTEGER),
+	ingestTimeBudgetUs(INGEST_DEFAULT_TIME_BUDGET_US),
+	ingestBudgetExceeded(0),
+	displayVisible(0),
+	lostBuffersProcessed(0),
+	lostBufferReports(0),
+	displayCopyFailures(0)
 {
 	qRegisterMetaType<AxialPsfAnalyzerParameters>("AxialPsfAnalyzerParameters");
+	qRegisterMetaType<FrameSlot*>("FrameSlot*");
+	qRegisterMetaType<FitResult>("FitResult");
 
 	this->setType(EXTENSION);
 	this->displayStyle = SEPARATE_WINDOW;
@@ -27,7 +35,6 @@ AxialPsfAnalyzer::AxialPsfAnalyzer()
 
 	this->setupGuiConnections();
 	this->setupPeakFit();
-	this->initializeFrameBuffers();
 }
 
 AxialPsfAnalyzer::~AxialPsfAnalyzer() {
@@ -36,8 +43,8 @@ AxialPsfAnalyzer::~AxialPsfAnalyzer() {
 
 	delete this->form;
 
-	this->releaseFrameBuffers(this->frameBuffersProcessed);
-	this->releaseFrameBuffers(this->frameBuffersRaw);
+	//frame ring is deleted last because consumer threads may still hold frame slots until they are stopped
+	delete this->frameRing;
 }
 
 QWidget* AxialPsfAnalyzer::getWidget() {
@@ -68,9 +75,24 @@ void AxialPsfAnalyzer::setupGuiConnections() {
 	//store settings
 	connect(this->form, &AxialPsfAnalyzerForm::paramsChanged, this, &AxialPsfAnalyzer::storeParameters);
 
+	//frame ring and ingest settings
+	connect(this->form, &AxialPsfAnalyzerForm::paramsChanged, this, [this](AxialPsfAnalyzerParameters params) {
+		this->frameRing->setDepth(params.frameRingDepth);
+		this->frameRing->setDropPolicy(params.frameDropPolicy);
+		this->ingestMode.storeRelease(static_cast<int>(params.ingestMode));
+		this->fusedReductionPossible.storeRelease((!params.lateralProfileEnabled && params.lineProjection == MEAN_PROJECTION) ? 1 : 0);
+		this->ingestTimeBudgetUs.storeRelease(params.ingestTimeBudgetUs);
+		this->sampleFormat.storeRelease(static_cast<int>(params.sampleFormat));
+		QMutexLocker locker(&this->roiMutex);
+		this->roi = params.roi;
+	});
+
 	//image display connections
 	ImageDisplay* imageDisplay = this->form->getImageDisplay();
 	connect(this, &AxialPsfAnalyzer::newFrame, imageDisplay, &ImageDisplay::receiveFrame);
+	connect(imageDisplay, &ImageDisplay::visibilityChanged, this, [this](bool visible) {
+		this->displayVisible.storeRelease(visible ? 1 : 0);
+	});
 	connect(imageDisplay, &ImageDisplay::roiChanged, this, [this](const QRect& rect) {
 		QString rectString = QString("ROI: %1, %2, %3, %4").arg(rect.x()).arg(rect.y()).arg(rect.width()).arg(rect.height());
 		emit this->info(rectString);
@@ -101,8 +123,9 @@ void AxialPsfAnalyzer::setupPeakFit() {
 	this->peakFit = new PeakFit();
 	this->peakFit->moveToThread(&peakFitThread);
 	ImageDisplay* imageDisplay = this->form->getImageDisplay();
-	connect(this, &AxialPsfAnalyzer::newFrame, this->peakFit, &PeakFit::fitPeak);
+	connect(this, &AxialPsfAnalyzer::newFitFrame, this->peakFit, &PeakFit::fitPeak);
 	connect(imageDisplay, &ImageDisplay::roiChanged, this->peakFit, &PeakFit::setRoi);
+	connect(this->form, &AxialPsfAnalyzerForm::paramsChanged, this->peakFit, &PeakFit::invalidate, Qt::DirectConnection);
 	connect(this->form, &AxialPsfAnalyzerForm::paramsChanged, this->peakFit, &PeakFit::setParams);
 	connect(this->peakFit, &PeakFit::info, this, &AxialPsfAnalyzer::info);
 	connect(this->peakFit, &PeakFit::error, this, &AxialPsfAnalyzer::error);
@@ -112,25 +135,169 @@ void AxialPsfAnalyzer::setupPeakFit() {
 	//connect(this->peakFit, &PeakFit::peakPositionFound, this->form, &AxialPsfAnalyzerForm::plotPeakPositionIndicator);
 	connect(this->peakFit, &PeakFit::peakPositionFound, this->form, &AxialPsfAnalyzerForm::displayPeakPositionValue);
 	connect(this->peakFit, &PeakFit::fwhmCalculated, this->form, &AxialPsfAnalyzerForm::displayFwhmValue);
+	connect(this->peakFit, &PeakFit::halfMaxFwhmCalculated, this->form, &AxialPsfAnalyzerForm::displayHalfMaxFwhmValue);
+	connect(this->peakFit, &PeakFit::multiPeakFitCalculated, this->form, &AxialPsfAnalyzerForm::displayMultiPeakResult);
+	connect(this->peakFit, &PeakFit::lateralProfileCalculated, this->form, &AxialPsfAnalyzerForm::plotLateralProfile);
+	connect(this->peakFit, &PeakFit::fitResultCalculated, this->form, &AxialPsfAnalyzerForm::displayFitResult);
 	peakFitThread.start();
 }
 
-void AxialPsfAnalyzer::initializeFrameBuffers() {
-	this->frameBuffersRaw.resize(NUMBER_OF_BUFFERS);
-	this->frameBuffersProcessed.resize(NUMBER_OF_BUFFERS);
-	for(int i = 0; i < NUMBER_OF_BUFFERS; i++){
-		this->frameBuffersRaw[i] = nullptr;
-		this->frameBuffersProcessed[i] = nullptr;
+void AxialPsfAnalyzer::reportLostBuffers() {
+	//frames are dropped by the frame ring (no free slot) or skipped by consumers (superseded by newer frame)
+	int droppedFrames = this->frameRing->getDroppedFrames();
+	if(droppedFrames != this->lostBuffersProcessed){
+		this->lostBuffersProcessed = droppedFrames;
+		//frames are dropped continuously while the fit is slower than the acquisition, so only the first and every 100th drop is logged
+		this->lostBufferReports++;
+		if(this->lostBufferReports == 1 || this->lostBufferReports % 100 == 0){
+			emit info(this->name + ":  " + tr("Frames dropped: ") + QString::number(this->lostBuffersProcessed));
+		}
+	}
+}
+
+FrameSlot* AxialPsfAnalyzer::copyFrame(const char* frame, PIXEL_TYPE pixelType, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, bool forFit) {
+	size_t bytesPerSample = PixelType::bytesPerSample(pixelType);
+	size_t bytesPerFrame = samplesPerLine*linesPerFrame*bytesPerSample;
+
+	FrameSlot* slot = this->frameRing->acquireForWrite(bytesPerFrame);
+	if(slot == nullptr){
+		return nullptr;
+	}
+	memcpy(slot->data, frame, bytesPerFrame);
+
+	//fingerprint only covers the roi, changes outside of it do not change the fit result. a frame that only goes to the image display keeps ROI_FINGERPRINT_NONE
+	if(forFit){
+		QRect roi;
+		this->roiMutex.lock();
+		roi = this->roi;
+		this->roiMutex.unlock();
+		QRect clampedRoi = PeakFit::clampRoi(roi, samplesPerLine, linesPerFrame);
+		slot->fingerprint = RoiFingerprint::calculate(slot->data, pixelType, static_cast<int>(samplesPerLine), clampedRoi.x(), clampedRoi.y(), clampedRoi.width(), clampedRoi.height());
+	}
+	slot->content = FRAME_DATA;
+	slot->pixelType = pixelType;
+	slot->bitDepth = bitDepth;
+	slot->samplesPerLine = samplesPerLine;
+	slot->linesPerFrame = linesPerFrame;
+	slot->originX = 0;
+	slot->originY = 0;
+	slot->frameSamplesPerLine = samplesPerLine;
+	slot->frameLinesPerFrame = linesPerFrame;
+	return slot;
+}
+
+FrameSlot* AxialPsfAnalyzer::copyRoi(const char* frame, PIXEL_TYPE pixelType, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame) {
+	QRect roi;
+	this->roiMutex.lock();
+	roi = this->roi;
+	this->roiMutex.unlock();
+
+	//copy only clamped roi into compact buffer (row stride == roi width)
+	QRect clampedRoi = PeakFit::clampRoi(roi, samplesPerLine, linesPerFrame);
+	size_t bytesPerSample = PixelType::bytesPerSample(pixelType);
+	size_t bytesPerRoiLine = static_cast<size_t>(clampedRoi.width())*bytesPerSample;
+	size_t bytesPerRoi = bytesPerRoiLine*static_cast<size_t>(clampedRoi.height());
+
+	FrameSlot* slot = this->frameRing->acquireForWrite(bytesPerRoi);
+	if(slot == nullptr){
+		return nullptr;
+	}
+	//every copied line is hashed while it is still in cache. the fingerprint uses the position of the roi within the frame, so it is the same as the one of copyFrame(..)
+	char* roiData = static_cast<char*>(slot->data);
+	RoiFingerprint fingerprint(pixelType, clampedRoi.x(), clampedRoi.y(), clampedRoi.width());
+	for(int y = 0; y < clampedRoi.height(); y++){
+		size_t frameOffset = (static_cast<size_t>(clampedRoi.y()+y)*samplesPerLine + static_cast<size_t>(clampedRoi.x()))*bytesPerSample;
+		memcpy(&(roiData[y*bytesPerRoiLine]), &(frame[frameOffset]), bytesPerRoiLine);
+		fingerprint.addLines(&(roiData[y*bytesPerRoiLine]), clampedRoi.width(), 1);
 	}
+	slot->fingerprint = fingerprint.result();
+	slot->content = FRAME_DATA;
+	slot->pixelType = pixelType;
+	slot->bitDepth = bitDepth;
+	slot->samplesPerLine = static_cast<unsigned int>(clampedRoi.width());
+	slot->linesPerFrame = static_cast<unsigned int>(clampedRoi.height());
+	slot->originX = static_cast<unsigned int>(clampedRoi.x());
+	slot->originY = static_cast<unsigned int>(clampedRoi.y());
+	slot->frameSamplesPerLine = samplesPerLine;
+	slot->frameLinesPerFrame = linesPerFrame;
+	return slot;
 }
 
-void AxialPsfAnalyzer::releaseFrameBuffers(QVector<void *> buffers) {
-	for (int i = 0; i < buffers.size(); i++) {
-		if (buffers[i] != nullptr) {
-			free(buffers[i]);
-			buffers[i] = nullptr;
+FrameSlot* AxialPsfAnalyzer::reduceRoi(const char* frame, PIXEL_TYPE pixelType, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame) {
+	QElapsedTimer timer;
+	timer.start();
+
+	QRect roi;
+	this->roiMutex.lock();
+	roi = this->roi;
+	this->roiMutex.unlock();
+
+	//sum up roi columns directly from the buffer of the processing thread. only the column sums are copied into the frame slot
+	QRect clampedRoi = PeakFit::clampRoi(roi, samplesPerLine, linesPerFrame);
+	int roiWidth = qMax(0, clampedRoi.width());
+	int roiHeight = qMax(0, clampedRoi.height());
+	FrameSlot* slot = this->frameRing->acquireForWrite(static_cast<size_t>(roiWidth)*sizeof(double));
+	if(slot == nullptr){
+		return nullptr;
+	}
+	double* sums = static_cast<double*>(slot->data);
+	for(int i = 0; i < roiWidth; i++){
+		sums[i] = 0.0;
+	}
+
+	//latency guard: lines are summed in blocks and the reduction stops as soon as the time budget is exhausted. the average over the lines summed so far is still valid.
+	//every block is hashed right after it is summed up, so the fingerprint covers exactly the summed lines and its time counts against the budget
+	qint64 budgetNs = static_cast<qint64>(this->ingestTimeBudgetUs.loadAcquire())*1000;
+	size_t bytesPerSample = PixelType::bytesPerSample(pixelType);
+	RoiFingerprint fingerprint(pixelType, clampedRoi.x(), clampedRoi.y(), roiWidth);
+	int linesSummed = 0;
+	while(linesSummed < roiHeight){
+		int lines = qMin(INGEST_LINES_PER_BLOCK, roiHeight-linesSummed);
+		if(!ColumnSum::accumulate(frame, pixelType, static_cast<int>(samplesPerLine), clampedRoi.x(), clampedRoi.y()+linesSummed, roiWidth, lines, sums)){
+			this->frameRing->cancelWrite(slot);
+			return nullptr;
+		}
+		size_t blockOffset = (static_cast<size_t>(clampedRoi.y()+linesSummed)*samplesPerLine + static_cast<size_t>(clampedRoi.x()))*bytesPerSample;
+		fingerprint.addLines(&(frame[blockOffset]), static_cast<int>(samplesPerLine), lines);
+		linesSummed += lines;
+		if(linesSummed < roiHeight && timer.nsecsElapsed() > budgetNs){
+			this->ingestBudgetExceeded++;
+			if(this->ingestBudgetExceeded == 1 || this->ingestBudgetExceeded % 100 == 0){
+				emit info(this->name + ":  " + tr("Ingest time budget exceeded, only %1 of %2 lines averaged (%3 times)").arg(linesSummed).arg(roiHeight).arg(this->ingestBudgetExceeded));
+			}
+			break;
 		}
 	}
+
+	slot->fingerprint = fingerprint.result();
+	slot->content = COLUMN_SUMS;
+	slot->pixelType = pixelType;
+	slot->bitDepth = bitDepth;
+	slot->samplesPerLine = static_cast<unsigned int>(roiWidth);
+	slot->linesPerFrame = static_cast<unsigned int>(linesSummed);
+	slot->originX = static_cast<unsigned int>(clampedRoi.x());
+	slot->originY = static_cast<unsigned int>(clampedRoi.y());
+	slot->frameSamplesPerLine = samplesPerLine;
+	slot->frameLinesPerFrame = linesPerFrame;
+	return slot;
+}
+
+void AxialPsfAnalyzer::publishFrame(FrameSlot* slot, bool forFit, bool forDisplay) {
+	//every receiver holds one reference to the slot
+	int consumers = 0;
+	if(forFit){
+		consumers += this->receivers(SIGNAL(newFitFrame(FrameSlot*)));
+	}
+	if(forDisplay){
+		consumers += this->receivers(SIGNAL(newFrame(FrameSlot*)));
+	}
+	this->frameRing->publish(slot, consumers);
+	if(forFit){
+		emit newFitFrame(slot);
+	}
+	if(forDisplay){
+		emit newFrame(slot);
+	}
 }
 
 void AxialPsfAnalyzer::storeParameters() {
@@ -167,9 +334,9 @@ void AxialPsfAnalyzer::processedDataReceived(void* buffer, unsigned int bitDepth
 
 			this->isCalculating = true;
 
-			//calculate size of single frame
-			size_t bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(bitDepth)/8.0));
-			size_t bytesPerFrame = samplesPerLine*linesPerFrame*bytesPerSample;
+			//get sample type of processed data and calculate size of single frame
+			PIXEL_TYPE pixelType = PixelType::fromBitDepth(bitDepth, static_cast<SAMPLE_FORMAT>(this->sampleFormat.loadAcquire()));
+			size_t bytesPerFrame = static_cast<size_t>(samplesPerLine)*linesPerFrame*PixelType::bytesPerSample(pixelType);
 
 			//check if number of frames per buffer has changed and emit maxFrames to update gui
 			if(this->framesPerBuffer != framesPerBuffer){
@@ -182,28 +349,67 @@ void AxialPsfAnalyzer::processedDataReceived(void* buffer, unsigned int bitDepth
 				this->buffersPerVolume = buffersPerVolume;
 			}
 
-			//check if buffer size changed and allocate buffer memory
-			if(this->frameBuffersProcessed[0] == nullptr || this->bytesPerFrameProcessed != bytesPerFrame){
-				if(bitDepth == 0 || samplesPerLine == 0 || linesPerFrame == 0 || framesPerBuffer == 0){
-					emit error(this->name + ":  " + tr("Invalid data dimensions!"));
-					return;
-				}
-				//(re)create copy buffers
-				if(this->frameBuffersProcessed[0] != nullptr){
-					this->releaseFrameBuffers(this->frameBuffersProcessed);
+			if(bitDepth == 0 || samplesPerLine == 0 || linesPerFrame == 0 || framesPerBuffer == 0){
+				emit error(this->name + ":  " + tr("Invalid data dimensions!"));
+				this->isCalculating = false;
+				return;
+			}
+			if(pixelType == PIXEL_INVALID){
+				emit error(this->name + ":  " + tr("Unsupported bit depth: ") + QString::number(bitDepth));
+				this->isCalculating = false;
+				return;
+			}
+
+			//select frame within buffer
+			if(this->frameNr>static_cast<int>(framesPerBuffer-1)){this->frameNr = static_cast<int>(framesPerBuffer-1);}
+			const char* frame = &(static_cast<const char*>(buffer)[bytesPerFrame*this->frameNr]);
+
+			//copy frame into free slots of frame ring. the complete frame is only copied if it is needed for the image display, otherwise only the roi is copied or directly reduced to column sums.
+			//the lateral profile and the order statistic projections (median, trimmed mean, max) need the single A-scans, so the roi is copied instead of reduced if one of them is enabled
+			//the processing thread is never blocked: if all slots are still in use the frame is dropped
+			bool displayVisible = this->displayVisible.loadAcquire() != 0;
+			INGEST_MODE ingestMode = static_cast<INGEST_MODE>(this->ingestMode.loadAcquire());
+			FrameSlot* fitSlot = nullptr;
+			FrameSlot* displaySlot = nullptr;
+			if(ingestMode == FUSED_ROI_REDUCTION && this->fusedReductionPossible.loadAcquire() != 0){
+				fitSlot = this->reduceRoi(frame, pixelType, bitDepth, samplesPerLine, linesPerFrame);
+				if(displayVisible){
+					displaySlot = this->copyFrame(frame, pixelType, bitDepth, samplesPerLine, linesPerFrame, false);
+					//fit and display need two fresh slots per frame here, while the fit keeps its last frame. without a free slot the display stops updating
+					if(displaySlot == nullptr){
+						this->displayCopyFailures++;
+						if(this->displayCopyFailures == 1 || this->displayCopyFailures % 100 == 0){
+							emit info(this->name + ":  " + tr("No free frame slot for the image display, frame ring depth is too small (%1 times)").arg(this->displayCopyFailures));
+						}
+					}
 				}
-				for (int i = 0; i < this->frameBuffersProcessed.size(); i++) {
-					this->frameBuffersProcessed[i] = static_cast<void*>(malloc(bytesPerFrame));
+			}else if(ingestMode != FULL_FRAME && !displayVisible){
+				fitSlot = this->copyRoi(frame, pixelType, bitDepth, samplesPerLine, linesPerFrame);
+			}else{
+				//complete frame is shared between fit and display
+				fitSlot = this->copyFrame(frame, pixelType, bitDepth, samplesPerLine, linesPerFrame, true);
+				if(displayVisible){
+					displaySlot = fitSlot;
 				}
-				this->bytesPerFrameProcessed = bytesPerFrame;
 			}
 
-			//copy single frame of received data and emit it for further processing
-			this->copyBufferId = (this->copyBufferId+1)%NUMBER_OF_BUFFERS;
-			char* frameInBuffer = static_cast<char*>(buffer);
-			if(this->frameNr>static_cast<int>(framesPerBuffer-1)){this->frameNr = static_cast<int>(framesPerBuffer-1);}
-			memcpy(this->frameBuffersProcessed[this->copyBufferId], &(frameInBuffer[bytesPerFrame*this->frameNr]), bytesPerFrame);
-			emit newFrame(this->frameBuffersProcessed[this->copyBufferId], bitDepth, samplesPerLine, linesPerFrame);
+			//emit frame for further processing
+			if(fitSlot != nullptr && fitSlot == displaySlot){
+				this->publishFrame(fitSlot, true, true);
+			}else{
+				if(fitSlot != nullptr){
+					this->publishFrame(fitSlot, true, false);
+				}
+				if(displaySlot != nullptr){
+					this->publishFrame(displaySlot, false, true);
+				}
+			}
+			if(fitSlot == nullptr){
+				this->reportLostBuffers();
+				this->isCalculating = false;
+				return;
+			}
+			this->reportLostBuffers();
 
 			this->isCalculating = false;
 			this->singleFetch = false;
@@ -4,11 +4,15 @@
 
 #include <QCoreApplication>
 #include <QThread>
+#include <QMutex>
+#include <QElapsedTimer>
 #include "octproz_devkit.h"
 #include "axialpsfanalyzerform.h"
 #include "peakfit.h"
+#include "framering.h"
+#include "columnsum.h"
 
-#define NUMBER_OF_BUFFERS 2
+#define INGEST_LINES_PER_BLOCK 64
 
 
 class AxialPsfAnalyzer : public Extension
@@ -40,20 +44,29 @@ private:
 	bool singleFetch;
 	bool autoFetch;
 
-	QVector<void*> frameBuffersRaw;
-	QVector<void*> frameBuffersProcessed;
-	int copyBufferId;
-	size_t bytesPerFrameRaw;
-	size_t bytesPerFrameProcessed;
+	FrameRing* frameRing;
+	QAtomicInt ingestMode; //INGEST_MODE, written by the gui thread and read by the thread that delivers the frames
+	QAtomicInt fusedReductionPossible; //0 (false) if the fit needs the single A-scans of the roi, not only their column sums
+	QAtomicInt sampleFormat; //SAMPLE_FORMAT
+	QAtomicInt ingestTimeBudgetUs;
+	int ingestBudgetExceeded;
+	QAtomicInt displayVisible;
+	QRect roi;
+	QMutex roiMutex;
 	int lostBuffersRaw;
 	int lostBuffersProcessed;
+	int lostBufferReports; //number of times a changed drop count was detected
+	int displayCopyFailures; //frames of the fused reduction mode that were reduced for the fit but not copied for the image display
 	unsigned int framesPerBuffer;
 	unsigned int buffersPerVolume;
 
 	void setupGuiConnections();
 	void setupPeakFit();
-	void initializeFrameBuffers();
-	void releaseFrameBuffers(QVector<void*> buffers);
+	void reportLostBuffers();
+	FrameSlot* copyFrame(const char* frame, PIXEL_TYPE pixelType, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, bool forFit); //forFit: the roi fingerprint is only calculated for frames that are fitted
+	FrameSlot* copyRoi(const char* frame, PIXEL_TYPE pixelType, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	FrameSlot* reduceRoi(const char* frame, PIXEL_TYPE pixelType, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	void publishFrame(FrameSlot* slot, bool forFit, bool forDisplay);
 
 public slots:
 	void storeParameters();
@@ -61,7 +74,8 @@ public slots:
 	virtual void processedDataReceived(void* buffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr) override;
 
 signals:
-	void newFrame(void* frame, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	void newFrame(FrameSlot* frame);
+	void newFitFrame(FrameSlot* frame);
 	void maxFrames(int max);
 	void maxBuffers(int max);
 };
@@ -25,6 +25,15 @@ AxialPsfAnalyzerForm::AxialPsfAnalyzerForm(QWidget *parent) :
 	connect(this->linePlot, &LinePlot::info, this, &AxialPsfAnalyzerForm::info);
 	connect(this->linePlot, &LinePlot::error, this, &AxialPsfAnalyzerForm::error);
 
+	//lateral profile plot: FWHM and peak position of every A-scan over the line number, only visible if the lateral profile is enabled
+	this->lateralProfilePlot = this->ui->widget_lateralProfilePlot;
+	this->lateralProfilePlot->setCurveName("FWHM");
+	this->lateralProfilePlot->setReferenceCurveName("Peak position - mean");
+	this->lateralProfilePlot->setLegendVisible(true);
+	this->lateralProfilePlot->setVisible(false);
+	connect(this->lateralProfilePlot, &LinePlot::info, this, &AxialPsfAnalyzerForm::info);
+	connect(this->lateralProfilePlot, &LinePlot::error, this, &AxialPsfAnalyzerForm::error);
+
 
 	//fetch push button and checkbox
 	connect(this->ui->pushButton_fetch, &QPushButton::clicked, this, &AxialPsfAnalyzerForm::singleFetchRequested); 
@@ -47,6 +56,13 @@ AxialPsfAnalyzerForm::AxialPsfAnalyzerForm(QWidget *parent) :
 		emit paramsChanged(this->parameters);
 	});
 	
+	//temporal averaging
+	this->ui->spinBox_temporalAverageFrames->setMaximum(TEMPORAL_AVERAGE_MAX_FRAMES);
+	connect(this->ui->spinBox_temporalAverageFrames, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int frames) {
+		this->parameters.temporalAverageFrames = frames;
+		emit paramsChanged(this->parameters);
+	});
+
 	//SpinBox buffer
 	this->ui->spinBox_buffer->setMaximum(2);
 	this->ui->spinBox_buffer->setMinimum(-1);
@@ -67,13 +83,79 @@ AxialPsfAnalyzerForm::AxialPsfAnalyzerForm(QWidget *parent) :
 	});
 	this->setMaximumFrameNr(512);	
 
+	//psf model, the combo box lists all models of the registry
+	QStringList modelNames = PsfModelRegistry::instance().getNames();
+	for (int i = 0; i < modelNames.size(); i++) {
+		this->ui->comboBox_psfModel->addItem(PsfModelRegistry::instance().getDisplayName(modelNames.at(i)), modelNames.at(i));
+	}
+	connect(this->ui->comboBox_psfModel, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index){
+		this->parameters.psfModel = this->ui->comboBox_psfModel->itemData(index).toString();
+		this->enableFitModeSelection(this->parameters.psfModel == GaussianModel::name());
+		emit paramsChanged(this->parameters);
+	});
+
+	//multi peak
+	connect(this->ui->spinBox_maxPeakCount, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int count) {
+		this->parameters.maxPeakCount = count;
+		this->ui->widget_multiPeakResult->setVisible(count > 1);
+		emit paramsChanged(this->parameters);
+	});
+
+	//lateral profile
+	connect(this->ui->checkBox_lateralProfile, &QCheckBox::toggled, this, [this](bool enabled){
+		this->parameters.lateralProfileEnabled = enabled;
+		this->lateralProfilePlot->setVisible(enabled);
+		emit paramsChanged(this->parameters);
+	});
+
 	//fit mode
 	connect(this->ui->radioButton_linearFitMode, &QRadioButton::toggled, this, [this](bool enabled){
 		bool logartihmMode = !enabled;
 		this->parameters.fitModeLogarithmEnabled = logartihmMode;
+		this->ui->checkBox_logFitRefinement->setEnabled(logartihmMode);
 		emit fitModeLogarithmEnabled(logartihmMode);
 		emit paramsChanged(this->parameters);
 	});
+	connect(this->ui->checkBox_logFitRefinement, &QCheckBox::toggled, this, [this](bool enabled){
+		this->parameters.logFitRefinementEnabled = enabled;
+		emit paramsChanged(this->parameters);
+	});
+
+	//fwhm estimator
+	connect(this->ui->comboBox_fwhmEstimator, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index){
+		this->parameters.fwhmEstimator = static_cast<FWHM_ESTIMATOR>(index);
+		this->ui->comboBox_halfMaxInterpolation->setEnabled(this->parameters.fwhmEstimator != GAUSS_FIT_FWHM);
+		this->ui->widget_halfMaxResult->setVisible(this->parameters.fwhmEstimator == GAUSS_FIT_AND_HALF_MAXIMUM_FWHM);
+		emit paramsChanged(this->parameters);
+	});
+	connect(this->ui->comboBox_halfMaxInterpolation, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index){
+		this->parameters.halfMaxInterpolation = static_cast<HALF_MAX_INTERPOLATION>(index);
+		emit paramsChanged(this->parameters);
+	});
+
+	//adaptive fit window
+	connect(this->ui->checkBox_adaptiveFitWindow, &QCheckBox::toggled, this, [this](bool enabled){
+		this->parameters.fitWindowEnabled = enabled;
+		emit paramsChanged(this->parameters);
+	});
+
+	//projection of the A-scans within the roi to one line
+	connect(this->ui->comboBox_lineProjection, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index){
+		this->parameters.lineProjection = static_cast<LINE_PROJECTION>(index);
+		emit paramsChanged(this->parameters);
+	});
+
+	//upsampling, combo box index i is factor 2^i
+	connect(this->ui->comboBox_upsampling, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index){
+		this->parameters.upsamplingFactor = 1 << index;
+		emit paramsChanged(this->parameters);
+	});
+
+	//robust loss
+	connect(this->ui->comboBox_robustLoss, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index){
+		this->parameters.robustLoss = static_cast<ROBUST_LOSS>(index);
+		emit paramsChanged(this->parameters);
+	});
 
 	//autoscaling
 	connect(this->ui->checkBox_autoscaling, &QCheckBox::stateChanged, this, [this](int state) {
@@ -104,7 +186,34 @@ AxialPsfAnalyzerForm::AxialPsfAnalyzerForm(QWidget *parent) :
 	this->parameters.nthBuffer = 10;
 	this->parameters.autoScalingEnabled = true;
 	this->parameters.autoFetchingEnabled = true;
+	this->parameters.psfModel = PSF_MODEL_DEFAULT;
+	this->parameters.maxPeakCount = 1;
+	this->parameters.peakMinProminence = PEAK_FINDER_DEFAULT_MIN_PROMINENCE;
 	this->parameters.fitModeLogarithmEnabled = false;
+	this->parameters.logFitRefinementEnabled = false;
+	this->parameters.fwhmEstimator = GAUSS_FIT_FWHM;
+	this->parameters.halfMaxInterpolation = LINEAR_INTERPOLATION;
+	this->parameters.frameRingDepth = FRAME_RING_DEFAULT_DEPTH;
+	this->parameters.frameDropPolicy = DROP_NEWEST;
+	this->parameters.ingestMode = ROI_ONLY;
+	this->parameters.ingestTimeBudgetUs = INGEST_DEFAULT_TIME_BUDGET_US;
+	this->parameters.sampleFormat = UNSIGNED_INTEGER;
+	this->parameters.parallelReductionThreshold = COLUMN_SUM_DEFAULT_PARALLEL_THRESHOLD;
+	this->parameters.fitEstimateAcceptanceThreshold = 0.0;
+	this->parameters.fitWarmStartEnabled = true;
+	this->parameters.fitTimeBudgetUs = FIT_DEFAULT_TIME_BUDGET_US;
+	this->parameters.fitWindowEnabled = true;
+	this->parameters.fitWindowSigmaFactor = FIT_WINDOW_DEFAULT_SIGMA_FACTOR;
+	this->parameters.robustLoss = LEAST_SQUARES_LOSS;
+	this->parameters.lateralProfileEnabled = false;
+	this->parameters.upsamplingFactor = 1;
+	this->parameters.temporalAverageFrames = 1;
+	this->parameters.lineProjection = MEAN_PROJECTION;
+	this->parameters.projectionTrimFraction = COLUMN_PROJECTION_DEFAULT_TRIM_FRACTION;
+
+	//half maximum fwhm is only shown side by side with gauss fit fwhm, results of all peaks only in multi peak mode
+	this->ui->widget_halfMaxResult->setVisible(false);
+	this->ui->widget_multiPeakResult->setVisible(false);
 }
 
 AxialPsfAnalyzerForm::~AxialPsfAnalyzerForm() {
@@ -125,22 +234,73 @@ void AxialPsfAnalyzerForm::setSettings(QVariantMap settings) {
 		this->parameters.roi = QRect(roiX, roiY, roiWidth, roiHeight);
 		this->parameters.autoScalingEnabled = settings.value(AXIALPSF_AUTOSCALING_ENABLED).toBool();
 		this->parameters.autoFetchingEnabled = settings.value(AXIALPSF_AUTOFETCHING_ENABLED).toBool();
+		this->parameters.psfModel = settings.value(AXIALPSF_PSF_MODEL, PSF_MODEL_DEFAULT).toString();
+		this->parameters.maxPeakCount = qBound(1, settings.value(AXIALPSF_MAX_PEAK_COUNT, 1).toInt(), PEAK_FINDER_MAX_PEAKS);
+		this->parameters.peakMinProminence = settings.value(AXIALPSF_PEAK_MIN_PROMINENCE, PEAK_FINDER_DEFAULT_MIN_PROMINENCE).toDouble();
 		this->parameters.fitModeLogarithmEnabled = settings.value(AXIALPSF_LOG_FIT_ENABLED).toBool();
+		this->parameters.logFitRefinementEnabled = settings.value(AXIALPSF_LOG_FIT_REFINEMENT_ENABLED).toBool();
+		this->parameters.fwhmEstimator = static_cast<FWHM_ESTIMATOR>(settings.value(AXIALPSF_FWHM_ESTIMATOR, static_cast<int>(GAUSS_FIT_FWHM)).toInt());
+		this->parameters.halfMaxInterpolation = static_cast<HALF_MAX_INTERPOLATION>(settings.value(AXIALPSF_HALF_MAX_INTERPOLATION, static_cast<int>(LINEAR_INTERPOLATION)).toInt());
 		this->parameters.splitterState = settings.value(AXIALPSF_SPLITTER_STATE).toByteArray();
 		this->parameters.windowState = settings.value(AXIALPSF_WINDOW_STATE).toByteArray();
+		this->parameters.frameRingDepth = settings.value(AXIALPSF_FRAME_RING_DEPTH, FRAME_RING_DEFAULT_DEPTH).toInt();
+		this->parameters.frameDropPolicy = static_cast<FRAME_DROP_POLICY>(settings.value(AXIALPSF_FRAME_DROP_POLICY, static_cast<int>(DROP_NEWEST)).toInt());
+		this->parameters.ingestMode = static_cast<INGEST_MODE>(settings.value(AXIALPSF_INGEST_MODE, static_cast<int>(ROI_ONLY)).toInt());
+		this->parameters.ingestTimeBudgetUs = settings.value(AXIALPSF_INGEST_TIME_BUDGET, INGEST_DEFAULT_TIME_BUDGET_US).toInt();
+		this->parameters.sampleFormat = static_cast<SAMPLE_FORMAT>(settings.value(AXIALPSF_SAMPLE_FORMAT, static_cast<int>(UNSIGNED_INTEGER)).toInt());
+		this->parameters.parallelReductionThreshold = settings.value(AXIALPSF_PARALLEL_REDUCTION_THRESHOLD, COLUMN_SUM_DEFAULT_PARALLEL_THRESHOLD).toInt();
+		this->parameters.fitEstimateAcceptanceThreshold = settings.value(AXIALPSF_FIT_ESTIMATE_ACCEPTANCE_THRESHOLD, 0.0).toDouble();
+		this->parameters.fitWarmStartEnabled = settings.value(AXIALPSF_FIT_WARM_START_ENABLED, true).toBool();
+		this->parameters.fitTimeBudgetUs = settings.value(AXIALPSF_FIT_TIME_BUDGET, FIT_DEFAULT_TIME_BUDGET_US).toInt();
+		this->parameters.fitWindowEnabled = settings.value(AXIALPSF_FIT_WINDOW_ENABLED, true).toBool();
+		this->parameters.fitWindowSigmaFactor = settings.value(AXIALPSF_FIT_WINDOW_SIGMA_FACTOR, FIT_WINDOW_DEFAULT_SIGMA_FACTOR).toDouble();
+		this->parameters.robustLoss = static_cast<ROBUST_LOSS>(settings.value(AXIALPSF_ROBUST_LOSS, static_cast<int>(LEAST_SQUARES_LOSS)).toInt());
+		this->parameters.lateralProfileEnabled = settings.value(AXIALPSF_LATERAL_PROFILE_ENABLED, false).toBool();
+		this->parameters.temporalAverageFrames = settings.value(AXIALPSF_TEMPORAL_AVERAGE_FRAMES, 1).toInt();
+		this->parameters.lineProjection = static_cast<LINE_PROJECTION>(settings.value(AXIALPSF_LINE_PROJECTION, static_cast<int>(MEAN_PROJECTION)).toInt());
+		this->parameters.projectionTrimFraction = qBound(0.0, settings.value(AXIALPSF_PROJECTION_TRIM_FRACTION, COLUMN_PROJECTION_DEFAULT_TRIM_FRACTION).toDouble(), 0.5);
+		this->parameters.upsamplingFactor = settings.value(AXIALPSF_UPSAMPLING_FACTOR, 1).toInt();
+		if(!SincUpsampler::isValidFactor(this->parameters.upsamplingFactor)){
+			this->parameters.upsamplingFactor = 1;
+		}
 	}
 
 	//update GUI elements
 	this->ui->spinBox_buffer->setValue(this->parameters.bufferNr);
 	this->ui->spinBox_nthBuffer->setValue(this->parameters.nthBuffer);
 	this->ui->checkBox_autoFetch->setChecked(this->parameters.autoFetchingEnabled);
+	this->ui->spinBox_temporalAverageFrames->setValue(this->parameters.temporalAverageFrames);
 	this->ui->horizontalSlider_frame->setValue(this->parameters.frameNr);
 	this->ui->widget_imageDisplay->setRoi(this->parameters.roi);
 	this->ui->checkBox_autoscaling->setChecked(this->parameters.autoScalingEnabled);
 	this->enableAutoScalingLinePlot(this->parameters.autoScalingEnabled);
 	this->ui->radioButton_linearFitMode->setChecked(!this->parameters.fitModeLogarithmEnabled);
+	this->ui->radioButton_logarithmicFitMode->setChecked(this->parameters.fitModeLogarithmEnabled);
+	this->ui->checkBox_logFitRefinement->setChecked(this->parameters.logFitRefinementEnabled);
+	int modelIndex = this->ui->comboBox_psfModel->findData(this->parameters.psfModel);
+	this->ui->comboBox_psfModel->setCurrentIndex(modelIndex >= 0 ? modelIndex : this->ui->comboBox_psfModel->findData(QString(PSF_MODEL_DEFAULT)));
+	this->enableFitModeSelection(this->parameters.psfModel == GaussianModel::name());
+	this->ui->spinBox_maxPeakCount->setValue(this->parameters.maxPeakCount);
+	this->ui->widget_multiPeakResult->setVisible(this->parameters.maxPeakCount > 1);
+	this->ui->checkBox_lateralProfile->setChecked(this->parameters.lateralProfileEnabled);
+	this->lateralProfilePlot->setVisible(this->parameters.lateralProfileEnabled);
+	this->ui->comboBox_fwhmEstimator->setCurrentIndex(static_cast<int>(this->parameters.fwhmEstimator));
+	this->ui->comboBox_halfMaxInterpolation->setCurrentIndex(static_cast<int>(this->parameters.halfMaxInterpolation));
+	this->ui->comboBox_halfMaxInterpolation->setEnabled(this->parameters.fwhmEstimator != GAUSS_FIT_FWHM);
+	this->ui->widget_halfMaxResult->setVisible(this->parameters.fwhmEstimator == GAUSS_FIT_AND_HALF_MAXIMUM_FWHM);
+	this->ui->checkBox_adaptiveFitWindow->setChecked(this->parameters.fitWindowEnabled);
+	this->ui->comboBox_robustLoss->setCurrentIndex(static_cast<int>(this->parameters.robustLoss));
+	this->ui->comboBox_lineProjection->setCurrentIndex(static_cast<int>(this->parameters.lineProjection));
+	int upsamplingIndex = 0;
+	while((1 << upsamplingIndex) < this->parameters.upsamplingFactor){
+		upsamplingIndex++;
+	}
+	this->ui->comboBox_upsampling->setCurrentIndex(upsamplingIndex);
 	this->ui->splitter->restoreState(this->parameters.splitterState);
 	this->restoreGeometry(this->parameters.windowState);
+
+	//parameters without gui element (e.g. frame ring settings) need to be propagated explicitly
+	emit paramsChanged(this->parameters);
 }
 
 void AxialPsfAnalyzerForm::getSettings(QVariantMap* settings) {
@@ -158,9 +318,32 @@ void AxialPsfAnalyzerForm::getSettings(QVariantMap* settings) {
 	settings->insert(AXIALPSF_ROI_HEIGHT, this->parameters.roi.height());
 	settings->insert(AXIALPSF_AUTOSCALING_ENABLED, this->parameters.autoScalingEnabled);
 	settings->insert(AXIALPSF_AUTOFETCHING_ENABLED, this->parameters.autoFetchingEnabled);
+	settings->insert(AXIALPSF_PSF_MODEL, this->parameters.psfModel);
+	settings->insert(AXIALPSF_MAX_PEAK_COUNT, this->parameters.maxPeakCount);
+	settings->insert(AXIALPSF_PEAK_MIN_PROMINENCE, this->parameters.peakMinProminence);
 	settings->insert(AXIALPSF_LOG_FIT_ENABLED, this->parameters.fitModeLogarithmEnabled);
+	settings->insert(AXIALPSF_LOG_FIT_REFINEMENT_ENABLED, this->parameters.logFitRefinementEnabled);
+	settings->insert(AXIALPSF_FWHM_ESTIMATOR, static_cast<int>(this->parameters.fwhmEstimator));
+	settings->insert(AXIALPSF_HALF_MAX_INTERPOLATION, static_cast<int>(this->parameters.halfMaxInterpolation));
 	settings->insert(AXIALPSF_SPLITTER_STATE, this->parameters.splitterState);
 	settings->insert(AXIALPSF_WINDOW_STATE, this->parameters.windowState);
+	settings->insert(AXIALPSF_FRAME_RING_DEPTH, this->parameters.frameRingDepth);
+	settings->insert(AXIALPSF_FRAME_DROP_POLICY, static_cast<int>(this->parameters.frameDropPolicy));
+	settings->insert(AXIALPSF_INGEST_MODE, static_cast<int>(this->parameters.ingestMode));
+	settings->insert(AXIALPSF_INGEST_TIME_BUDGET, this->parameters.ingestTimeBudgetUs);
+	settings->insert(AXIALPSF_SAMPLE_FORMAT, static_cast<int>(this->parameters.sampleFormat));
+	settings->insert(AXIALPSF_PARALLEL_REDUCTION_THRESHOLD, this->parameters.parallelReductionThreshold);
+	settings->insert(AXIALPSF_FIT_ESTIMATE_ACCEPTANCE_THRESHOLD, this->parameters.fitEstimateAcceptanceThreshold);
+	settings->insert(AXIALPSF_FIT_WARM_START_ENABLED, this->parameters.fitWarmStartEnabled);
+	settings->insert(AXIALPSF_FIT_TIME_BUDGET, this->parameters.fitTimeBudgetUs);
+	settings->insert(AXIALPSF_FIT_WINDOW_ENABLED, this->parameters.fitWindowEnabled);
+	settings->insert(AXIALPSF_FIT_WINDOW_SIGMA_FACTOR, this->parameters.fitWindowSigmaFactor);
+	settings->insert(AXIALPSF_ROBUST_LOSS, static_cast<int>(this->parameters.robustLoss));
+	settings->insert(AXIALPSF_LATERAL_PROFILE_ENABLED, this->parameters.lateralProfileEnabled);
+	settings->insert(AXIALPSF_UPSAMPLING_FACTOR, this->parameters.upsamplingFactor);
+	settings->insert(AXIALPSF_TEMPORAL_AVERAGE_FRAMES, this->parameters.temporalAverageFrames);
+	settings->insert(AXIALPSF_LINE_PROJECTION, static_cast<int>(this->parameters.lineProjection));
+	settings->insert(AXIALPSF_PROJECTION_TRIM_FRACTION, this->parameters.projectionTrimFraction);
 }
 
 bool AxialPsfAnalyzerForm::eventFilter(QObject *watched, QEvent *event) {
@@ -173,6 +356,13 @@ bool AxialPsfAnalyzerForm::eventFilter(QObject *watched, QEvent *event) {
 	return QWidget::eventFilter(watched, event);
 }
 
+void AxialPsfAnalyzerForm::enableFitModeSelection(bool enable) {
+	//logarithmic fit mode only exists for the Gaussian
+	this->ui->radioButton_linearFitMode->setEnabled(enable);
+	this->ui->radioButton_logarithmicFitMode->setEnabled(enable);
+	this->ui->checkBox_logFitRefinement->setEnabled(enable && this->parameters.fitModeLogarithmEnabled);
+}
+
 void AxialPsfAnalyzerForm::setMaximumFrameNr(int maximum) {
 	this->ui->horizontalSlider_frame->setMaximum(maximum);
 	this->ui->spinBox_frame->setMaximum(maximum);
@@ -241,6 +431,68 @@ void AxialPsfAnalyzerForm::displayFwhmValue(double value) {
 	}
 }
 
+void AxialPsfAnalyzerForm::displayHalfMaxFwhmValue(double value) {
+	if(value < 0){
+		this->ui->lineEdit_fwhmHalfMax->setText(tr("No half maximum crossing"));
+	} else {
+		this->ui->lineEdit_fwhmHalfMax->setText(QString::number(value, 'f', 2) + " px");
+	}
+}
+
+void AxialPsfAnalyzerForm::displayMultiPeakResult(QVector<qreal> positions, QVector<qreal> fwhms) {
+	if(positions.isEmpty()){
+		this->ui->lineEdit_multiPeakResult->setText(tr("No peak detected"));
+		return;
+	}
+	QString text;
+	for(int i = 0; i < positions.size() && i < fwhms.size(); i++){
+		if(i > 0){
+			text += "; ";
+		}
+		text += QString::number(positions.at(i), 'f', 2) + " / " + QString::number(fwhms.at(i), 'f', 2) + " px";
+	}
+	this->ui->lineEdit_multiPeakResult->setText(text);
+}
+
+void AxialPsfAnalyzerForm::plotLateralProfile(QVector<qreal> lines, QVector<qreal> peakPositions, QVector<qreal> fwhms) {
+	//peak position is shown relative to its mean, so it has the same scale as the FWHM. lines without valid fit are NaN and shown as gaps
+	double positionSum = 0.0;
+	int validPositions = 0;
+	for(int i = 0; i < peakPositions.size(); i++){
+		if(qIsFinite(peakPositions.at(i))){
+			positionSum += peakPositions.at(i);
+			validPositions++;
+		}
+	}
+	double meanPosition = validPositions > 0 ? positionSum / validPositions : 0.0;
+	QVector<qreal> positionDeviations(peakPositions.size());
+	for(int i = 0; i < peakPositions.size(); i++){
+		positionDeviations[i] = peakPositions.at(i) - meanPosition;
+	}
+	this->lateralProfilePlot->plotCurve(lines, fwhms);
+	this->lateralProfilePlot->plotReferenceCurve(lines, positionDeviations);
+}
+
+void AxialPsfAnalyzerForm::displayFitResult(FitResult result) {
+	//1 sigma uncertainties and goodness of fit
+	const FitQuality& quality = result.quality;
+	if(quality.valid && result.fwhm >= 0){
+		this->ui->lineEdit_fwhm->setText(QString::number(result.fwhm, 'f', 2) + " ± " + QString::number(quality.fwhmSigma, 'f', 2) + " px");
+		this->ui->lineEdit_peakPosition->setText(QString::number(result.peakPosition, 'f', 2) + " ± " + QString::number(quality.peakPositionSigma, 'f', 2));
+	}
+	if(quality.valid){
+		this->ui->label_fitQuality->setText(tr("R² = %1    reduced χ² = %2    residual rms = %3").arg(quality.rSquared, 0, 'f', 4).arg(quality.reducedChiSquared, 0, 'g', 4).arg(quality.residualRms, 0, 'g', 4));
+	} else {
+		this->ui->label_fitQuality->setText(tr("Fit quality not available"));
+	}
+
+	//fit was aborted by the time budget: values are shown, but marked as not converged
+	if(result.budgetExceeded){
+		this->ui->lineEdit_fwhm->setText(this->ui->lineEdit_fwhm->text() + " " + tr("(budget exceeded)"));
+	}
+	this->ui->lineEdit_fwhm->setToolTip(tr("Fit time: %1 us, budget exceeded in %2 of %3 fits").arg(result.fitTimeUs).arg(result.budgetExceededCount).arg(result.fitCount));
+}
+
 void AxialPsfAnalyzerForm::enableAutoScalingLinePlot(bool autoScaleEnabled) {
 	this->linePlot->enableAutoScaling(autoScaleEnabled);
 }
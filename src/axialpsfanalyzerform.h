@@ -4,6 +4,7 @@
 #include <QWidget>
 #include <QRect>
 #include "axialpsfanalyzerparameters.h"
+#include "fitresult.h"
 #include "lineplot.h"
 #include "imagedisplay.h"
 
@@ -40,14 +41,21 @@ public slots:
 	void plotPeakPositionIndicator(double pos);
 	void displayPeakPositionValue(double pos);
 	void displayFwhmValue(double value);
+	void displayHalfMaxFwhmValue(double value);
+	void displayMultiPeakResult(QVector<qreal> positions, QVector<qreal> fwhms);
+	void plotLateralProfile(QVector<qreal> lines, QVector<qreal> peakPositions, QVector<qreal> fwhms);
+	void displayFitResult(FitResult result);
 	void enableAutoScalingLinePlot(bool autoScaleEnabled);
 
 private:
 	ImageDisplay* imageDisplay;
 	LinePlot* linePlot;
+	LinePlot* lateralProfilePlot;
 	AxialPsfAnalyzerParameters parameters;
 	bool firstRun;
 
+	void enableFitModeSelection(bool enable);
+
 signals:
 	void paramsChanged(AxialPsfAnalyzerParameters);
 	void frameNrChanged(int);
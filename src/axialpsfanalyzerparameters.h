@@ -6,6 +6,16 @@
 #include <QMetaType>
 #include <QRect>
 #include <QByteArray>
+#include "framering.h"
+#include "pixeltype.h"
+#include "columnsum.h"
+#include "columnprojection.h"
+#include "halfmaximumwidth.h"
+#include "psfmodelregistry.h"
+#include "peakfinder.h"
+#include "robustweights.h"
+#include "sincupsampler.h"
+#include "temporalaverage.h"
 
 #define AXIALPSF_SOURCE "image_source"
 #define AXIALPSF_FRAME "frame_number"
@@ -17,9 +27,36 @@
 #define AXIALPSF_ROI_HEIGHT "roi_height"
 #define AXIALPSF_AUTOSCALING_ENABLED "auto_scaling_enabled"
 #define AXIALPSF_AUTOFETCHING_ENABLED "auto_fetching_enabled"
+#define AXIALPSF_PSF_MODEL "psf_model"
+#define AXIALPSF_MAX_PEAK_COUNT "max_peak_count"
+#define AXIALPSF_PEAK_MIN_PROMINENCE "peak_min_prominence"
 #define AXIALPSF_LOG_FIT_ENABLED "logarithm_fit_mode_enabled"
+#define AXIALPSF_LOG_FIT_REFINEMENT_ENABLED "logarithm_fit_refinement_enabled"
+#define AXIALPSF_FWHM_ESTIMATOR "fwhm_estimator"
+#define AXIALPSF_HALF_MAX_INTERPOLATION "half_max_interpolation"
 #define AXIALPSF_SPLITTER_STATE "splitter_state"
 #define AXIALPSF_WINDOW_STATE "window_state"
+#define AXIALPSF_FRAME_RING_DEPTH "frame_ring_depth"
+#define AXIALPSF_FRAME_DROP_POLICY "frame_drop_policy"
+#define AXIALPSF_INGEST_MODE "ingest_mode"
+#define AXIALPSF_INGEST_TIME_BUDGET "ingest_time_budget_us"
+#define AXIALPSF_SAMPLE_FORMAT "sample_format"
+#define AXIALPSF_PARALLEL_REDUCTION_THRESHOLD "parallel_reduction_threshold"
+#define AXIALPSF_FIT_ESTIMATE_ACCEPTANCE_THRESHOLD "fit_estimate_acceptance_threshold"
+#define AXIALPSF_FIT_WARM_START_ENABLED "fit_warm_start_enabled"
+#define AXIALPSF_FIT_TIME_BUDGET "fit_time_budget_us"
+#define AXIALPSF_FIT_WINDOW_ENABLED "fit_window_enabled"
+#define AXIALPSF_FIT_WINDOW_SIGMA_FACTOR "fit_window_sigma_factor"
+#define AXIALPSF_ROBUST_LOSS "robust_loss"
+#define AXIALPSF_LATERAL_PROFILE_ENABLED "lateral_profile_enabled"
+#define AXIALPSF_UPSAMPLING_FACTOR "upsampling_factor"
+#define AXIALPSF_TEMPORAL_AVERAGE_FRAMES "temporal_average_frames"
+#define AXIALPSF_LINE_PROJECTION "line_projection"
+#define AXIALPSF_PROJECTION_TRIM_FRACTION "projection_trim_fraction"
+
+#define INGEST_DEFAULT_TIME_BUDGET_US 2000
+#define FIT_DEFAULT_TIME_BUDGET_US 5000
+#define FIT_WINDOW_DEFAULT_SIGMA_FACTOR 4.0
 
 
 enum BUFFER_SOURCE{
@@ -27,6 +64,18 @@ enum BUFFER_SOURCE{
 	PROCESSED
 };
 
+enum INGEST_MODE{
+	FULL_FRAME, //complete frame is copied
+	ROI_ONLY, //only roi is copied, complete frame is copied only if image display is visible
+	FUSED_ROI_REDUCTION //roi column sums are calculated directly in the callback of the processing thread, no frame is copied for the fit
+};
+
+enum FWHM_ESTIMATOR{
+	GAUSS_FIT_FWHM, //FWHM of fitted Gaussian
+	HALF_MAXIMUM_FWHM, //half maximum crossings interpolated on the averaged line, no fit
+	GAUSS_FIT_AND_HALF_MAXIMUM_FWHM //both side by side
+};
+
 struct AxialPsfAnalyzerParameters {
 	BUFFER_SOURCE bufferSource;
 	QRect roi;
@@ -35,9 +84,32 @@ struct AxialPsfAnalyzerParameters {
 	int nthBuffer;
 	bool autoScalingEnabled;
 	bool autoFetchingEnabled;
+	QString psfModel; //name of a model in PsfModelRegistry
+	int maxPeakCount; //1: one peak is fitted in the complete roi
+	double peakMinProminence; //relative to max-min of the averaged line
 	bool fitModeLogarithmEnabled;
+	bool logFitRefinementEnabled;
+	FWHM_ESTIMATOR fwhmEstimator;
+	HALF_MAX_INTERPOLATION halfMaxInterpolation;
 	QByteArray splitterState;
 	QByteArray windowState;
+	int frameRingDepth;
+	FRAME_DROP_POLICY frameDropPolicy;
+	INGEST_MODE ingestMode;
+	int ingestTimeBudgetUs;
+	SAMPLE_FORMAT sampleFormat;
+	int parallelReductionThreshold;
+	double fitEstimateAcceptanceThreshold;
+	bool fitWarmStartEnabled;
+	int fitTimeBudgetUs;
+	bool fitWindowEnabled; //only samples within +-fitWindowSigmaFactor*sigma around the estimated peak are fitted
+	double fitWindowSigmaFactor;
+	bool lateralProfileEnabled; //every A-scan of the roi is fitted on its own in addition to the averaged line. not possible with FUSED_ROI_REDUCTION, which is bypassed then
+	LINE_PROJECTION lineProjection; //how the A-scans of the roi are combined to one line. other projections than the mean are not possible with FUSED_ROI_REDUCTION, which is bypassed then
+	double projectionTrimFraction; //fraction of the lowest and of the highest values of each column discarded by TRIMMED_MEAN_PROJECTION
+	int temporalAverageFrames; //averaged line of the roi is averaged over the last n fetched frames (sliding window). 1 disables
+	int upsamplingFactor; //averaged line within the roi is sinc interpolated by this factor (power of two) before estimation and fit. 1 disables
+	ROBUST_LOSS robustLoss; //samples with large residuals (side lobes, ghosts) are down-weighted by iteratively reweighted least squares
 };
 Q_DECLARE_METATYPE(AxialPsfAnalyzerParameters)
 
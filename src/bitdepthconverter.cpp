@@ -1,5 +1,43 @@
 #include "bitdepthconverter.h"
 #include <QtMath>
+#include <limits>
+#include <cstring>
+
+
+//conversion kernel for one sample type, called via PixelType::dispatch
+//unsigned values are mapped from [0, 2^bitDepth-1] and signed values from [-2^(bitDepth-1), 2^(bitDepth-1)-1] to [0, 255]
+template<typename T>
+struct ConversionKernel {
+	static void run(const void* inputData, uchar* output8bitData, int length, int bitDepth) {
+		const T* input = static_cast<const T*>(inputData);
+		float offset = std::numeric_limits<T>::is_signed ? static_cast<float>(qPow(2, bitDepth-1)) : 0.0f;
+		float factor = 255 / (qPow(2,bitDepth) - 1);
+		for(int i=0; i<length; i++){
+			output8bitData[i] = static_cast<uchar>(qBound(0.0f, (input[i] + offset) * factor, 255.0f));
+		}
+	}
+};
+
+//floating point data has no fixed range, so it is mapped from [min, max] of the frame to [0, 255]
+template<>
+struct ConversionKernel<float> {
+	static void run(const void* inputData, uchar* output8bitData, int length, int bitDepth) {
+		Q_UNUSED(bitDepth)
+		const float* input = static_cast<const float*>(inputData);
+		float min = std::numeric_limits<float>::max();
+		float max = std::numeric_limits<float>::lowest();
+		for(int i=0; i<length; i++){
+			if(qIsFinite(input[i])){
+				min = qMin(min, input[i]);
+				max = qMax(max, input[i]);
+			}
+		}
+		float factor = max > min ? 255.0f / (max - min) : 0.0f;
+		for(int i=0; i<length; i++){
+			output8bitData[i] = qIsFinite(input[i]) ? static_cast<uchar>(qBound(0.0f, (input[i] - min) * factor, 255.0f)) : 0;
+		}
+	}
+};
 
 
 BitDepthConverter::BitDepthConverter(QObject *parent) : QObject(parent)
@@ -17,7 +55,7 @@ BitDepthConverter::~BitDepthConverter()
 	}
 }
 
-void BitDepthConverter::convertDataTo8bit(void *inputData, int bitDepth, int samplesPerLine, int linesPerFrame) {
+void BitDepthConverter::convertDataTo8bit(void *inputData, PIXEL_TYPE pixelType, int bitDepth, int samplesPerLine, int linesPerFrame) {
 	if(!this->conversionRunning){
 		this->conversionRunning = true;
 		int length = samplesPerLine * linesPerFrame;
@@ -26,6 +64,7 @@ void BitDepthConverter::convertDataTo8bit(void *inputData, int bitDepth, int sam
 		if(this->output8bitData == nullptr || this->bitDepth != bitDepth || this->length != length){
 			if(bitDepth == 0 || length == 0){
 				emit error(tr("BitDepthConverter: Invalid data dimensions!"));
+				this->conversionRunning = false;
 				return;
 			}
 			this->bitDepth = bitDepth;
@@ -36,27 +75,13 @@ void BitDepthConverter::convertDataTo8bit(void *inputData, int bitDepth, int sam
 			}
 			this->output8bitData = static_cast<uchar*>(malloc(length*sizeof(uchar)));
 		}
-		//no conversion needed if inputData is already 8bit or below
-		if (bitDepth <= 8){
-			for(int i=0; i<length; i++){
-				this->output8bitData[i] = static_cast<ushort*>(inputData)[i]; //todo: replace this for loop by memcpy
-			}
-		}
-		//convert to 8 bit element by element
-		else if (bitDepth >= 9 && bitDepth <=16){
-			float factor = 255 / (qPow(2,bitDepth) - 1);
-			for(int i=0; i<length; i++){
-				this->output8bitData[i] = static_cast<ushort*>(inputData)[i] * factor;
-				//this->output8bitData[i] = static_cast<uchar*>(inputData)[2*i+1]; //for 16 bit to 8 bit this is also possible
-			}
+		//no conversion needed if inputData is already 8bit
+		if (pixelType == PIXEL_UINT8 && bitDepth == 8){
+			memcpy(this->output8bitData, inputData, static_cast<size_t>(length));
 		}
-		else if (bitDepth > 16 && bitDepth <=32){
-			float factor = 255 / (qPow(2,bitDepth) - 1);
-			for(int i=0; i<length; i++){
-				this->output8bitData[i] = static_cast<unsigned int*>(inputData)[i] * factor;
-			}
-		//do nothing if bit depth is out of range
-		}else{
+		//convert to 8 bit element by element with the kernel that matches the pixel type. do nothing if pixel type is invalid
+		else if (!PixelType::dispatch<ConversionKernel>(pixelType, inputData, this->output8bitData, length, bitDepth)){
+			this->conversionRunning = false;
 			return;
 		}
 
@@ -64,3 +89,11 @@ void BitDepthConverter::convertDataTo8bit(void *inputData, int bitDepth, int sam
 		this->conversionRunning = false;
 	}
 }
+
+void BitDepthConverter::convertFrameTo8bit(FrameSlot* frame) {
+	//frame data is copied into output8bitData, so the frame slot can be released right after conversion
+	if(frame->acquire()){
+		this->convertDataTo8bit(frame->data, frame->pixelType, frame->bitDepth, frame->samplesPerLine, frame->linesPerFrame);
+	}
+	frame->release();
+}
@@ -2,6 +2,8 @@
 #define BITDEPTHCONVERTER_H
 
 #include <QObject>
+#include "framering.h"
+#include "pixeltype.h"
 
 class BitDepthConverter : public QObject
 {
@@ -17,7 +19,8 @@ private:
 	bool conversionRunning;
 
 public slots:
-	void convertDataTo8bit(void *inputData, int bitDepth, int samplesPerLine, int linesPerFrame);
+	void convertDataTo8bit(void *inputData, PIXEL_TYPE pixelType, int bitDepth, int samplesPerLine, int linesPerFrame);
+	void convertFrameTo8bit(FrameSlot* frame);
 
 signals:
 	void converted8bitData(uchar *output8bitData, unsigned int samplesPerLine, unsigned int linesPerFrame);
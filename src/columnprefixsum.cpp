@@ -0,0 +1,114 @@
+#include "columnprefixsum.h"
+#include <QThreadPool>
+#include <QtConcurrent>
+
+
+//kernel instantiation for one sample type, called via PixelType::dispatch. prefix sums of the columns x to x+width-1 are written to table
+//every table line is the previous table line plus one line of data, so the inner loop has no dependency between columns and can be vectorized
+template<typename T>
+struct ColumnPrefixSumKernel {
+	static void run(const void* data, size_t stride, int x, int width, int height, int tableWidth, double* table) {
+		const T* samples = static_cast<const T*>(data);
+		double* previous = &table[x];
+		for (int i = 0; i < width; i++) {
+			previous[i] = 0.0;
+		}
+		for (int y = 0; y < height; y++) {
+			const T* line = &samples[static_cast<size_t>(y)*stride + static_cast<size_t>(x)];
+			double* current = previous + tableWidth;
+			for (int i = 0; i < width; i++) {
+				current[i] = previous[i] + static_cast<double>(line[i]);
+			}
+			previous = current;
+		}
+	}
+};
+
+
+//columns x to x+width-1 whose prefix sums are calculated by one worker thread of buildParallel(..)
+struct ColumnPrefixSumBand {
+	int x;
+	int width;
+	bool success;
+};
+
+
+ColumnPrefixSum::ColumnPrefixSum()
+	: width(0),
+	height(0)
+{
+
+}
+
+bool ColumnPrefixSum::prepare(PIXEL_TYPE pixelType, int width, int height) {
+	this->clear();
+	if (pixelType == PIXEL_INVALID || width <= 0 || height <= 0) {
+		return false;
+	}
+	//table memory only grows, so dragging the roi over frames of the same size never reallocates
+	int tableSize = (height+1) * width;
+	if (this->table.size() < tableSize) {
+		this->table.resize(tableSize);
+	}
+	return true;
+}
+
+bool ColumnPrefixSum::build(const void* data, PIXEL_TYPE pixelType, int stride, int width, int height) {
+	if (!this->prepare(pixelType, width, height)) {
+		return false;
+	}
+	if (!PixelType::dispatch<ColumnPrefixSumKernel>(pixelType, data, static_cast<size_t>(stride), 0, width, height, width, this->table.data())) {
+		return false;
+	}
+	this->width = width;
+	this->height = height;
+	return true;
+}
+
+bool ColumnPrefixSum::buildParallel(const void* data, PIXEL_TYPE pixelType, int stride, int width, int height) {
+	//columns are independent of each other, so every worker thread gets a band of columns and writes to its own part of each table line
+	int threads = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+	int bands = qMin(threads, width / COLUMN_PREFIX_SUM_MIN_COLUMNS_PER_TASK);
+	if (bands <= 1) {
+		return this->build(data, pixelType, stride, width, height);
+	}
+	if (!this->prepare(pixelType, width, height)) {
+		return false;
+	}
+	QVector<ColumnPrefixSumBand> tasks(bands);
+	int columnsPerBand = width / bands;
+	for (int i = 0; i < bands; i++) {
+		tasks[i].x = i * columnsPerBand;
+		tasks[i].width = (i == bands-1) ? width - tasks[i].x : columnsPerBand;
+		tasks[i].success = false;
+	}
+	double* tableData = this->table.data();
+	QtConcurrent::blockingMap(tasks, [&](ColumnPrefixSumBand& band) {
+		band.success = PixelType::dispatch<ColumnPrefixSumKernel>(pixelType, data, static_cast<size_t>(stride), band.x, band.width, height, width, tableData);
+	});
+	for (int i = 0; i < bands; i++) {
+		if (!tasks[i].success) {
+			return false;
+		}
+	}
+	this->width = width;
+	this->height = height;
+	return true;
+}
+
+void ColumnPrefixSum::clear() {
+	this->width = 0;
+	this->height = 0;
+}
+
+bool ColumnPrefixSum::sum(int x, int y, int width, int height, double* sums) const {
+	if (!this->isValid() || x < 0 || y < 0 || width < 0 || height < 0 || x + width > this->width || y + height > this->height) {
+		return false;
+	}
+	const double* top = &this->table.constData()[static_cast<size_t>(y)*this->width + x];
+	const double* bottom = top + static_cast<size_t>(height)*this->width;
+	for (int i = 0; i < width; i++) {
+		sums[i] = bottom[i] - top[i];
+	}
+	return true;
+}
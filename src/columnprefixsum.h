@@ -0,0 +1,41 @@
+#ifndef COLUMNPREFIXSUM_H
+#define COLUMNPREFIXSUM_H
+
+#include <QtGlobal>
+#include <QVector>
+#include "pixeltype.h"
+
+#define COLUMN_PREFIX_SUM_MIN_COLUMNS_PER_TASK 64 //smallest band of columns whose prefix sums are calculated by one worker thread
+
+
+//per column prefix sums (summed-area table along the lines) of a frame. line y of the table holds the sums of the lines 0 to y-1 of each column, line 0 is zero.
+//building the table costs one pass over the frame, afterwards the column sums of any rectangle are the difference of two table lines: O(width) instead of O(width*height).
+//this is used to average the A-scans of a new roi instantly while the roi is dragged
+class ColumnPrefixSum
+{
+public:
+	ColumnPrefixSum();
+
+	//builds the table of lines 0 to height-1 and samples 0 to width-1 of data. stride is the number of samples per line in data
+	bool build(const void* data, PIXEL_TYPE pixelType, int stride, int width, int height);
+
+	//same as build(..) but bands of columns are processed by the threads of the global QThreadPool
+	bool buildParallel(const void* data, PIXEL_TYPE pixelType, int stride, int width, int height);
+
+	void clear();
+	bool isValid() const { return this->width > 0; }
+	int getWidth() const { return this->width; }
+	int getHeight() const { return this->height; }
+
+	//writes the sums of lines y to y+height-1 of the columns x to x+width-1 to sums (sums must have at least width elements). the rectangle must be within the table
+	bool sum(int x, int y, int width, int height, double* sums) const;
+
+private:
+	bool prepare(PIXEL_TYPE pixelType, int width, int height);
+
+	int width;
+	int height;
+	QVector<double> table; //(height+1)*width values
+};
+
+#endif //COLUMNPREFIXSUM_H
@@ -0,0 +1,597 @@
+#include "columnprojection.h"
+#include "columnsum.h"
+#include <QVector>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLUMN_PROJECTION_X86_SIMD
+#include <immintrin.h>
+#endif
+
+//see COLUMN_SUM_TARGET_AVX2 in columnsum.cpp
+#if defined(__GNUC__) || defined(__clang__)
+#define COLUMN_PROJECTION_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define COLUMN_PROJECTION_TARGET_AVX2
+#endif
+
+
+//median of the n values of column (partially reordered). for an even number of values the two middle values are averaged
+template<typename T>
+static double columnMedian(T* column, int n) {
+	int middle = n / 2;
+	std::nth_element(column, column + middle, column + n);
+	double upper = static_cast<double>(column[middle]);
+	if (n % 2 != 0) {
+		return upper;
+	}
+	//after nth_element all values below the middle are smaller or equal, the lower middle value is their maximum
+	double lower = static_cast<double>(*std::max_element(column, column + middle));
+	return 0.5 * (lower + upper);
+}
+
+//mean of the values of column without the trimmed lowest and highest values (partially reordered)
+template<typename T>
+static double columnTrimmedMean(T* column, int n, int trimmed) {
+	if (trimmed > 0) {
+		std::nth_element(column, column + trimmed, column + n);
+		std::nth_element(column + trimmed, column + n - trimmed, column + n);
+	}
+	double sum = 0.0;
+	for (int i = trimmed; i < n - trimmed; i++) {
+		sum += static_cast<double>(column[i]);
+	}
+	return sum / (n - 2*trimmed);
+}
+
+//resizes buffer if it has less than size elements and sets the first size elements to value
+template<typename V>
+static V* prepareBuffer(QVector<V>& buffer, int size, V value) {
+	if (buffer.size() < size) {
+		buffer.resize(size);
+	}
+	V* data = buffer.data();
+	std::fill(data, data + size, value);
+	return data;
+}
+
+//buffer with at least size elements of type T within the 64 bit elements of storage, the content is not initialized
+template<typename T>
+static T* sampleBuffer(QVector<quint64>& storage, int size) {
+	int elements = static_cast<int>((static_cast<size_t>(size)*sizeof(T) + sizeof(quint64) - 1) / sizeof(quint64));
+	if (storage.size() < elements) {
+		storage.resize(elements);
+	}
+	return reinterpret_cast<T*>(storage.data());
+}
+
+//8 and 16 bit samples are mapped to unsigned keys of the same order, so the order statistics can be found by bisection or with histograms instead of sorting.
+//wider types have no key (bits == 0) and are partially sorted with std::nth_element
+template<typename T> struct ColumnProjectionKey { static const int bits = 0; static quint32 key(T) { return 0; } static const int offset = 0; };
+template<> struct ColumnProjectionKey<quint8> { static const int bits = 8; static quint32 key(quint8 v) { return v; } static const int offset = 0; };
+template<> struct ColumnProjectionKey<qint8> { static const int bits = 8; static quint32 key(qint8 v) { return static_cast<quint32>(v + 128); } static const int offset = 128; };
+template<> struct ColumnProjectionKey<quint16> { static const int bits = 16; static quint32 key(quint16 v) { return v; } static const int offset = 0; };
+template<> struct ColumnProjectionKey<qint16> { static const int bits = 16; static quint32 key(qint16 v) { return static_cast<quint32>(v + 32768); } static const int offset = 32768; };
+
+//sum of the keys with rank first to last (in ascending order) within one histogram bin. rank is the rank of the lowest key of the bin
+static double rankRangeKeySum(const quint32* histogram, quint32 keyBase, int rank, int first, int last) {
+	double sum = 0.0;
+	for (int k = 0; k < 256 && rank <= last; k++) {
+		int count = static_cast<int>(histogram[k]);
+		int overlap = qMin(rank + count - 1, last) - qMax(rank, first) + 1;
+		if (overlap > 0) {
+			sum += static_cast<double>(overlap) * (keyBase + k);
+		}
+		rank += count;
+	}
+	return sum;
+}
+
+//bin of a 256 bin histogram that contains rank, rankBefore is the number of keys in all lower bins
+static int findBin(const quint32* histogram, int rank, int& rankBefore) {
+	rankBefore = 0;
+	for (int b = 0; b < 256; b++) {
+		if (rankBefore + static_cast<int>(histogram[b]) > rank) {
+			return b;
+		}
+		rankBefore += histogram[b];
+	}
+	return 255;
+}
+
+//mean of the values with rank first to last of each column of a block of 8 or 16 bit samples. one pass builds a histogram of the (high byte of the) keys,
+//for 16 bit keys a second pass builds histograms of the low byte for the two bins that contain the first and the last rank and sums up all keys of
+//the bins in between. the second pass is branchless, every sample increments both low byte histograms by 0 or 1
+template<typename T>
+static void rankMeansFromHistograms(ColumnProjectionWorkspace& workspace, const T* samples, size_t stride, int blockWidth, int height, int first, int last, double* result) {
+	typedef ColumnProjectionKey<T> Key;
+	const int shift = Key::bits - 8;
+	quint32* countData = prepareBuffer<quint32>(workspace.counts, blockWidth * 256, 0);
+	for (int y = 0; y < height; y++) {
+		const T* line = &samples[static_cast<size_t>(y)*stride];
+		for (int i = 0; i < blockWidth; i++) {
+			countData[i*256 + static_cast<int>(Key::key(line[i]) >> shift)]++;
+		}
+	}
+	int rangeSize = last - first + 1;
+	if (shift == 0) {
+		for (int i = 0; i < blockWidth; i++) {
+			result[i] = rankRangeKeySum(&countData[i*256], 0, 0, first, last) / rangeSize - Key::offset;
+		}
+		return;
+	}
+
+	//bins of the first and of the last rank. if both ranks are in the same bin only the first low byte histogram is used
+	int* firstBinData = prepareBuffer<int>(workspace.firstBins, blockWidth, 0);
+	int* lastBinData = prepareBuffer<int>(workspace.lastBins, blockWidth, 0);
+	int* firstRanks = prepareBuffer<int>(workspace.firstRanks, blockWidth, 0);
+	int* lastRanks = prepareBuffer<int>(workspace.lastRanks, blockWidth, 0);
+	for (int i = 0; i < blockWidth; i++) {
+		firstBinData[i] = findBin(&countData[i*256], first, firstRanks[i]);
+		lastBinData[i] = findBin(&countData[i*256], last, lastRanks[i]);
+	}
+	quint32* firstData = prepareBuffer<quint32>(workspace.firstHistograms, blockWidth * 256, 0);
+	quint32* lastData = prepareBuffer<quint32>(workspace.lastHistograms, blockWidth * 256, 0);
+	quint64* innerData = prepareBuffer<quint64>(workspace.innerSums, blockWidth, 0);
+	for (int y = 0; y < height; y++) {
+		const T* line = &samples[static_cast<size_t>(y)*stride];
+		for (int i = 0; i < blockWidth; i++) {
+			quint32 key = Key::key(line[i]);
+			int bin = static_cast<int>(key >> shift);
+			int low = i*256 + static_cast<int>(key & 0xff);
+			firstData[low] += (bin == firstBinData[i]);
+			lastData[low] += (bin == lastBinData[i] && bin != firstBinData[i]);
+			innerData[i] += (bin > firstBinData[i] && bin < lastBinData[i]) ? key : 0;
+		}
+	}
+	for (int i = 0; i < blockWidth; i++) {
+		double sum = static_cast<double>(innerData[i]) + rankRangeKeySum(&firstData[i*256], static_cast<quint32>(firstBinData[i]) << shift, firstRanks[i], first, last);
+		if (lastBinData[i] != firstBinData[i]) {
+			sum += rankRangeKeySum(&lastData[i*256], static_cast<quint32>(lastBinData[i]) << shift, lastRanks[i], first, last);
+		}
+		result[i] = sum / rangeSize - Key::offset;
+	}
+}
+
+//values of one block of COLUMN_PROJECTION_SELECT_BLOCK_WIDTH columns found by the bisection. all values are relative to the lowest key of their column
+struct ColumnRankSelection {
+	quint16 minima[COLUMN_PROJECTION_SELECT_BLOCK_WIDTH]; //lowest key of each column
+	quint16 firstValues[COLUMN_PROJECTION_SELECT_BLOCK_WIDTH]; //value with rank first
+	quint16 lastValues[COLUMN_PROJECTION_SELECT_BLOCK_WIDTH]; //value with rank last
+	quint16 countsAboveFirst[COLUMN_PROJECTION_SELECT_BLOCK_WIDTH]; //number of values above the first value (only if last > first)
+	quint16 countsBelowLast[COLUMN_PROJECTION_SELECT_BLOCK_WIDTH]; //number of values below the last value (only if last > first + 1)
+	quint32 innerSums[COLUMN_PROJECTION_SELECT_BLOCK_WIDTH]; //sum of the values between the first and the last value (only if last > first + 1)
+};
+
+//value with rank last of each column if last is first + 1: the first value if it occurs more than once at these ranks, otherwise the smallest value above it (nextValues)
+static void selectNextValues(ColumnRankSelection& selection, const quint16* nextValues, int height, int last) {
+	for (int i = 0; i < COLUMN_PROJECTION_SELECT_BLOCK_WIDTH; i++) {
+		bool firstValueAtLast = height - selection.countsAboveFirst[i] > last;
+		selection.lastValues[i] = firstValueAtLast ? selection.firstValues[i] : nextValues[i];
+	}
+}
+
+#ifdef COLUMN_PROJECTION_X86_SIMD
+//rank selection kernels. keys has COLUMN_PROJECTION_SELECT_BLOCK_WIDTH unsigned keys per line and is overwritten with the keys relative to the lowest key of their column in signed order
+//(xor 0x8000), so SSE2/AVX2 signed compares can be used. then the values with rank first and last are built bit by bit from the highest bit of the value range:
+//a bit is set if at most rank values are below the value with that bit set. every bit is one compare and count pass over the block, which stays in L1 cache.
+//for the median (last == first or first + 1) only the value with rank first is searched, the next higher value is the smallest value above it and is found with one more pass.
+//otherwise both values are searched at once and one more pass sums up the values between them and counts the values that are equal to them (at most 65535 lines)
+static void selectRanksSse2(quint16* keys, int height, int first, int last, ColumnRankSelection& selection) {
+	const __m128i sign = _mm_set1_epi16(static_cast<short>(0x8000));
+	const __m128i zero = _mm_setzero_si128();
+	__m128i* lines = reinterpret_cast<__m128i*>(keys);
+	__m128i low[2];
+	__m128i high[2];
+	for (int h = 0; h < 2; h++) {
+		low[h] = _mm_xor_si128(_mm_loadu_si128(&lines[h]), sign);
+		high[h] = low[h];
+	}
+	for (int y = 0; y < height; y++) {
+		for (int h = 0; h < 2; h++) {
+			__m128i v = _mm_xor_si128(_mm_loadu_si128(&lines[2*y + h]), sign);
+			low[h] = _mm_min_epi16(low[h], v);
+			high[h] = _mm_max_epi16(high[h], v);
+		}
+	}
+	quint16 spans[COLUMN_PROJECTION_SELECT_BLOCK_WIDTH];
+	for (int h = 0; h < 2; h++) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&selection.minima[8*h]), _mm_xor_si128(low[h], sign));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&spans[8*h]), _mm_sub_epi16(high[h], low[h]));
+	}
+	for (int y = 0; y < height; y++) {
+		for (int h = 0; h < 2; h++) {
+			__m128i v = _mm_xor_si128(_mm_loadu_si128(&lines[2*y + h]), sign);
+			_mm_storeu_si128(&lines[2*y + h], _mm_xor_si128(_mm_sub_epi16(v, low[h]), sign));
+		}
+	}
+	quint16 span = *std::max_element(spans, spans + COLUMN_PROJECTION_SELECT_BLOCK_WIDTH);
+	int bits = 0;
+	while ((span >> bits) != 0) {
+		bits++;
+	}
+
+	bool median = last - first <= 1;
+	const __m128i firstRank = _mm_set1_epi16(static_cast<short>(first ^ 0x8000));
+	const __m128i lastRank = _mm_set1_epi16(static_cast<short>(last ^ 0x8000));
+	__m128i firstValue[2] = {zero, zero};
+	__m128i lastValue[2] = {zero, zero};
+	for (int b = bits - 1; b >= 0; b--) {
+		const __m128i bit = _mm_set1_epi16(static_cast<short>(1 << b));
+		for (int h = 0; h < 2; h++) {
+			__m128i firstThreshold = _mm_xor_si128(_mm_or_si128(firstValue[h], bit), sign);
+			__m128i lastThreshold = _mm_xor_si128(_mm_or_si128(lastValue[h], bit), sign);
+			__m128i firstCount = zero;
+			__m128i lastCount = zero;
+			if (median) {
+				//two independent counters, so consecutive lines do not wait for each other
+				int y = 0;
+				for (; y + 1 < height; y += 2) {
+					firstCount = _mm_sub_epi16(firstCount, _mm_cmpgt_epi16(firstThreshold, _mm_loadu_si128(&lines[2*y + h])));
+					lastCount = _mm_sub_epi16(lastCount, _mm_cmpgt_epi16(firstThreshold, _mm_loadu_si128(&lines[2*y + 2 + h])));
+				}
+				if (y < height) {
+					firstCount = _mm_sub_epi16(firstCount, _mm_cmpgt_epi16(firstThreshold, _mm_loadu_si128(&lines[2*y + h])));
+				}
+				firstCount = _mm_add_epi16(firstCount, lastCount);
+			} else {
+				for (int y = 0; y < height; y++) {
+					__m128i v = _mm_loadu_si128(&lines[2*y + h]);
+					firstCount = _mm_sub_epi16(firstCount, _mm_cmpgt_epi16(firstThreshold, v));
+					lastCount = _mm_sub_epi16(lastCount, _mm_cmpgt_epi16(lastThreshold, v));
+				}
+				lastValue[h] = _mm_or_si128(lastValue[h], _mm_andnot_si128(_mm_cmpgt_epi16(_mm_xor_si128(lastCount, sign), lastRank), bit));
+			}
+			firstValue[h] = _mm_or_si128(firstValue[h], _mm_andnot_si128(_mm_cmpgt_epi16(_mm_xor_si128(firstCount, sign), firstRank), bit));
+		}
+	}
+	for (int h = 0; h < 2; h++) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&selection.firstValues[8*h]), firstValue[h]);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&selection.lastValues[8*h]), median ? firstValue[h] : lastValue[h]);
+	}
+	if (first == last) {
+		return;
+	}
+
+	//values above the first value and their minimum or their sum below the last value
+	const __m128i top = _mm_set1_epi16(0x7fff);
+	quint16 nextValues[COLUMN_PROJECTION_SELECT_BLOCK_WIDTH];
+	for (int h = 0; h < 2; h++) {
+		__m128i firstThreshold = _mm_xor_si128(firstValue[h], sign);
+		__m128i lastThreshold = _mm_xor_si128(lastValue[h], sign);
+		__m128i above = zero;
+		__m128i below = zero;
+		__m128i next = top;
+		__m128i sumLow = zero;
+		__m128i sumHigh = zero;
+		if (median) {
+			for (int y = 0; y < height; y++) {
+				__m128i v = _mm_loadu_si128(&lines[2*y + h]);
+				__m128i isAbove = _mm_cmpgt_epi16(v, firstThreshold);
+				above = _mm_sub_epi16(above, isAbove);
+				next = _mm_min_epi16(next, _mm_or_si128(_mm_and_si128(isAbove, v), _mm_andnot_si128(isAbove, top)));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&nextValues[8*h]), _mm_xor_si128(next, sign));
+		} else {
+			for (int y = 0; y < height; y++) {
+				__m128i v = _mm_loadu_si128(&lines[2*y + h]);
+				__m128i isAbove = _mm_cmpgt_epi16(v, firstThreshold);
+				__m128i isBelow = _mm_cmpgt_epi16(lastThreshold, v);
+				above = _mm_sub_epi16(above, isAbove);
+				below = _mm_sub_epi16(below, isBelow);
+				__m128i inner = _mm_and_si128(_mm_xor_si128(v, sign), _mm_and_si128(isAbove, isBelow));
+				sumLow = _mm_add_epi32(sumLow, _mm_unpacklo_epi16(inner, zero));
+				sumHigh = _mm_add_epi32(sumHigh, _mm_unpackhi_epi16(inner, zero));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&selection.countsBelowLast[8*h]), below);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&selection.innerSums[8*h]), sumLow);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&selection.innerSums[8*h + 4]), sumHigh);
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&selection.countsAboveFirst[8*h]), above);
+	}
+	if (median) {
+		selectNextValues(selection, nextValues, height, last);
+	}
+}
+
+COLUMN_PROJECTION_TARGET_AVX2
+static void selectRanksAvx2(quint16* keys, int height, int first, int last, ColumnRankSelection& selection) {
+	const __m256i sign = _mm256_set1_epi16(static_cast<short>(0x8000));
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i* lines = reinterpret_cast<__m256i*>(keys);
+	__m256i low = _mm256_loadu_si256(&lines[0]);
+	__m256i high = low;
+	for (int y = 0; y < height; y++) {
+		__m256i v = _mm256_loadu_si256(&lines[y]);
+		low = _mm256_min_epu16(low, v);
+		high = _mm256_max_epu16(high, v);
+	}
+	quint16 spans[COLUMN_PROJECTION_SELECT_BLOCK_WIDTH];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(selection.minima), low);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(spans), _mm256_sub_epi16(high, low));
+	for (int y = 0; y < height; y++) {
+		_mm256_storeu_si256(&lines[y], _mm256_xor_si256(_mm256_sub_epi16(_mm256_loadu_si256(&lines[y]), low), sign));
+	}
+	quint16 span = *std::max_element(spans, spans + COLUMN_PROJECTION_SELECT_BLOCK_WIDTH);
+	int bits = 0;
+	while ((span >> bits) != 0) {
+		bits++;
+	}
+
+	bool median = last - first <= 1;
+	const __m256i firstRank = _mm256_set1_epi16(static_cast<short>(first ^ 0x8000));
+	const __m256i lastRank = _mm256_set1_epi16(static_cast<short>(last ^ 0x8000));
+	__m256i firstValue = zero;
+	__m256i lastValue = zero;
+	for (int b = bits - 1; b >= 0; b--) {
+		const __m256i bit = _mm256_set1_epi16(static_cast<short>(1 << b));
+		__m256i firstThreshold = _mm256_xor_si256(_mm256_or_si256(firstValue, bit), sign);
+		__m256i lastThreshold = _mm256_xor_si256(_mm256_or_si256(lastValue, bit), sign);
+		__m256i firstCount = zero;
+		__m256i lastCount = zero;
+		if (median) {
+			int y = 0;
+			for (; y + 1 < height; y += 2) {
+				firstCount = _mm256_sub_epi16(firstCount, _mm256_cmpgt_epi16(firstThreshold, _mm256_loadu_si256(&lines[y])));
+				lastCount = _mm256_sub_epi16(lastCount, _mm256_cmpgt_epi16(firstThreshold, _mm256_loadu_si256(&lines[y + 1])));
+			}
+			if (y < height) {
+				firstCount = _mm256_sub_epi16(firstCount, _mm256_cmpgt_epi16(firstThreshold, _mm256_loadu_si256(&lines[y])));
+			}
+			firstCount = _mm256_add_epi16(firstCount, lastCount);
+		} else {
+			for (int y = 0; y < height; y++) {
+				__m256i v = _mm256_loadu_si256(&lines[y]);
+				firstCount = _mm256_sub_epi16(firstCount, _mm256_cmpgt_epi16(firstThreshold, v));
+				lastCount = _mm256_sub_epi16(lastCount, _mm256_cmpgt_epi16(lastThreshold, v));
+			}
+			lastValue = _mm256_or_si256(lastValue, _mm256_andnot_si256(_mm256_cmpgt_epi16(_mm256_xor_si256(lastCount, sign), lastRank), bit));
+		}
+		firstValue = _mm256_or_si256(firstValue, _mm256_andnot_si256(_mm256_cmpgt_epi16(_mm256_xor_si256(firstCount, sign), firstRank), bit));
+	}
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(selection.firstValues), firstValue);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(selection.lastValues), median ? firstValue : lastValue);
+	if (first == last) {
+		return;
+	}
+
+	const __m256i top = _mm256_set1_epi16(0x7fff);
+	__m256i firstThreshold = _mm256_xor_si256(firstValue, sign);
+	__m256i lastThreshold = _mm256_xor_si256(lastValue, sign);
+	__m256i above = zero;
+	if (median) {
+		__m256i next = top;
+		for (int y = 0; y < height; y++) {
+			__m256i v = _mm256_loadu_si256(&lines[y]);
+			__m256i isAbove = _mm256_cmpgt_epi16(v, firstThreshold);
+			above = _mm256_sub_epi16(above, isAbove);
+			next = _mm256_min_epi16(next, _mm256_blendv_epi8(top, v, isAbove));
+		}
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(selection.countsAboveFirst), above);
+		quint16 nextValues[COLUMN_PROJECTION_SELECT_BLOCK_WIDTH];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(nextValues), _mm256_xor_si256(next, sign));
+		selectNextValues(selection, nextValues, height, last);
+		return;
+	}
+	__m256i below = zero;
+	__m256i sumLow = zero;
+	__m256i sumHigh = zero;
+	for (int y = 0; y < height; y++) {
+		__m256i v = _mm256_loadu_si256(&lines[y]);
+		__m256i isAbove = _mm256_cmpgt_epi16(v, firstThreshold);
+		__m256i isBelow = _mm256_cmpgt_epi16(lastThreshold, v);
+		above = _mm256_sub_epi16(above, isAbove);
+		below = _mm256_sub_epi16(below, isBelow);
+		__m256i inner = _mm256_and_si256(_mm256_xor_si256(v, sign), _mm256_and_si256(isAbove, isBelow));
+		sumLow = _mm256_add_epi32(sumLow, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(inner)));
+		sumHigh = _mm256_add_epi32(sumHigh, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(inner, 1)));
+	}
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(selection.countsAboveFirst), above);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(selection.countsBelowLast), below);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(selection.innerSums), sumLow);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(&selection.innerSums[8]), sumHigh);
+}
+#endif //COLUMN_PROJECTION_X86_SIMD
+
+//copies the keys of a band of up to COLUMN_PROJECTION_BLOCK_WIDTH columns into one buffer of COLUMN_PROJECTION_SELECT_BLOCK_WIDTH keys per line for each block of the band.
+//every line of the band is read only once. a block with less columns is padded with its last column. the keys of a line are converted into a local array,
+//which can not overlap the frame, so the conversion is vectorized without runtime alias checks
+template<typename T>
+static void copyKeys(const T* samples, size_t stride, int bandWidth, int height, quint16* keys) {
+	typedef ColumnProjectionKey<T> Key;
+	const int blockSize = height * COLUMN_PROJECTION_SELECT_BLOCK_WIDTH;
+	quint16 lineKeys[COLUMN_PROJECTION_SELECT_BLOCK_WIDTH];
+	for (int y = 0; y < height; y++) {
+		const T* line = &samples[static_cast<size_t>(y)*stride];
+		for (int x = 0; x < bandWidth; x += COLUMN_PROJECTION_SELECT_BLOCK_WIDTH) {
+			const T* blockLine = &line[x];
+			int blockWidth = qMin(COLUMN_PROJECTION_SELECT_BLOCK_WIDTH, bandWidth - x);
+			if (blockWidth == COLUMN_PROJECTION_SELECT_BLOCK_WIDTH) {
+				for (int i = 0; i < COLUMN_PROJECTION_SELECT_BLOCK_WIDTH; i++) {
+					lineKeys[i] = static_cast<quint16>(Key::key(blockLine[i]));
+				}
+			} else {
+				for (int i = 0; i < COLUMN_PROJECTION_SELECT_BLOCK_WIDTH; i++) {
+					lineKeys[i] = static_cast<quint16>(Key::key(blockLine[qMin(i, blockWidth-1)]));
+				}
+			}
+			std::memcpy(&keys[(x / COLUMN_PROJECTION_SELECT_BLOCK_WIDTH)*blockSize + y*COLUMN_PROJECTION_SELECT_BLOCK_WIDTH], lineKeys, sizeof(lineKeys));
+		}
+	}
+}
+
+//mean of the values with rank first to last of each column of a block of 8 or 16 bit samples by bisection. values that are equal to the first or the last value
+//can have ranks outside of first to last, only as many of them as ranks are left are added. false if there is no SIMD kernel or there are too many lines
+template<typename T>
+static bool rankMeansFromBisection(ColumnProjectionWorkspace& workspace, const T* samples, size_t stride, int width, int height, int first, int last, double* result) {
+	ColumnSum::INSTRUCTION_SET instructionSet = ColumnSum::getInstructionSet();
+	if (instructionSet == ColumnSum::SCALAR || height > COLUMN_PROJECTION_SELECT_MAX_ROWS) {
+		return false;
+	}
+#ifdef COLUMN_PROJECTION_X86_SIMD
+	typedef ColumnProjectionKey<T> Key;
+	int rangeSize = last - first + 1;
+	bool sums = rangeSize > 2;
+	const int blockSize = height * COLUMN_PROJECTION_SELECT_BLOCK_WIDTH;
+	int size = blockSize * (COLUMN_PROJECTION_BLOCK_WIDTH / COLUMN_PROJECTION_SELECT_BLOCK_WIDTH);
+	if (workspace.keys.size() < size) {
+		workspace.keys.resize(size);
+	}
+	quint16* keys = workspace.keys.data();
+	ColumnRankSelection selection;
+	for (int x = 0; x < width; x += COLUMN_PROJECTION_BLOCK_WIDTH) {
+		int bandWidth = qMin(COLUMN_PROJECTION_BLOCK_WIDTH, width - x);
+		copyKeys(&samples[x], stride, bandWidth, height, keys);
+		for (int b = 0; b < bandWidth; b += COLUMN_PROJECTION_SELECT_BLOCK_WIDTH) {
+			quint16* blockKeys = &keys[(b / COLUMN_PROJECTION_SELECT_BLOCK_WIDTH)*blockSize];
+			if (instructionSet == ColumnSum::AVX2) {
+				selectRanksAvx2(blockKeys, height, first, last, selection);
+			} else {
+				selectRanksSse2(blockKeys, height, first, last, selection);
+			}
+			int blockWidth = qMin(COLUMN_PROJECTION_SELECT_BLOCK_WIDTH, bandWidth - b);
+			for (int i = 0; i < blockWidth; i++) {
+				double firstValue = selection.firstValues[i];
+				double lastValue = selection.lastValues[i];
+				double sum = firstValue + lastValue;
+				if (selection.firstValues[i] == selection.lastValues[i]) {
+					sum = firstValue * rangeSize;
+				} else if (sums) {
+					int firstCount = height - selection.countsAboveFirst[i] - first;
+					int lastCount = last + 1 - selection.countsBelowLast[i];
+					sum = static_cast<double>(selection.innerSums[i]) + firstValue*firstCount + lastValue*lastCount;
+				}
+				result[x + b + i] = sum / rangeSize + selection.minima[i] - Key::offset;
+			}
+		}
+	}
+	return true;
+#else
+	Q_UNUSED(workspace) Q_UNUSED(samples) Q_UNUSED(stride) Q_UNUSED(width) Q_UNUSED(first) Q_UNUSED(last) Q_UNUSED(result)
+	return false;
+#endif
+}
+
+//rank selection is only instantiated for sample types with a key
+template<typename T, bool hasKey = (ColumnProjectionKey<T>::bits > 0)>
+struct ColumnRankMeans {
+	static bool run(ColumnProjectionWorkspace&, const T*, size_t, int, int, int, int, double*) { return false; }
+};
+template<typename T>
+struct ColumnRankMeans<T, true> {
+	static bool run(ColumnProjectionWorkspace& workspace, const T* samples, size_t stride, int width, int height, int first, int last, double* result) {
+		if (rankMeansFromBisection(workspace, samples, stride, width, height, first, last, result)) {
+			return true;
+		}
+		for (int x = 0; x < width; x += COLUMN_PROJECTION_HISTOGRAM_BLOCK_WIDTH) {
+			int blockWidth = qMin(COLUMN_PROJECTION_HISTOGRAM_BLOCK_WIDTH, width - x);
+			rankMeansFromHistograms(workspace, &samples[x], stride, blockWidth, height, first, last, &result[x]);
+		}
+		return true;
+	}
+};
+
+//kernel instantiation for one sample type, called via PixelType::dispatch. data points to the first sample of the region
+template<typename T>
+struct ColumnProjectionKernel {
+	static void run(ColumnProjectionWorkspace* workspace, const void* data, size_t stride, int width, int height, LINE_PROJECTION projection, double trimFraction, double* result) {
+		const T* samples = static_cast<const T*>(data);
+		//ranks of the values that are averaged: the one or two middle values for the median, all values except the trimmed ones for the trimmed mean.
+		//at least one value is kept
+		int trimmed = qBound(0, static_cast<int>(trimFraction * height), (height-1) / 2);
+		int first = projection == MEDIAN_PROJECTION ? (height-1) / 2 : trimmed;
+		int last = projection == MEDIAN_PROJECTION ? height / 2 : height - 1 - trimmed;
+		if (ColumnRankMeans<T>::run(*workspace, samples, stride, width, height, first, last, result)) {
+			return;
+		}
+
+		T* columns = sampleBuffer<T>(workspace->samples, qMin(width, COLUMN_PROJECTION_BLOCK_WIDTH) * height);
+		for (int x = 0; x < width; x += COLUMN_PROJECTION_BLOCK_WIDTH) {
+			int blockWidth = qMin(COLUMN_PROJECTION_BLOCK_WIDTH, width - x);
+			for (int y = 0; y < height; y++) {
+				const T* line = &samples[static_cast<size_t>(y)*stride + static_cast<size_t>(x)];
+				for (int i = 0; i < blockWidth; i++) {
+					columns[i*height + y] = line[i];
+				}
+			}
+			for (int i = 0; i < blockWidth; i++) {
+				T* column = &columns[i*height];
+				result[x + i] = projection == MEDIAN_PROJECTION ? columnMedian(column, height) : columnTrimmedMean(column, height, trimmed);
+			}
+		}
+	}
+};
+
+
+//columns x to x+width-1 of the region that are projected by one worker thread of projectParallel(..)
+struct ColumnProjectionBand {
+	int x;
+	int width;
+	ColumnProjectionWorkspace* workspace;
+	bool success;
+};
+
+
+bool ColumnProjection::project(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, LINE_PROJECTION projection, double trimFraction, double* result) {
+	return projectRegion(this->workspace, data, pixelType, stride, x, y, width, height, projection, trimFraction, result);
+}
+
+bool ColumnProjection::projectRegion(ColumnProjectionWorkspace& workspace, const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, LINE_PROJECTION projection, double trimFraction, double* result) {
+	if (pixelType == PIXEL_INVALID) {
+		return false;
+	}
+	if (width <= 0 || height <= 0) {
+		return true;
+	}
+	if (projection == MEAN_PROJECTION) {
+		for (int i = 0; i < width; i++) {
+			result[i] = 0.0;
+		}
+		if (!ColumnSum::accumulate(data, pixelType, stride, x, y, width, height, result)) {
+			return false;
+		}
+		for (int i = 0; i < width; i++) {
+			result[i] /= height;
+		}
+		return true;
+	}
+	if (projection == MAX_PROJECTION) {
+		return ColumnSum::maximum(data, pixelType, stride, x, y, width, height, result);
+	}
+	size_t offset = (static_cast<size_t>(y)*static_cast<size_t>(stride) + static_cast<size_t>(x)) * PixelType::bytesPerSample(pixelType);
+	const void* regionData = &static_cast<const char*>(data)[offset];
+	return PixelType::dispatch<ColumnProjectionKernel>(pixelType, &workspace, regionData, static_cast<size_t>(stride), width, height, projection, trimFraction, result);
+}
+
+bool ColumnProjection::projectParallel(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, LINE_PROJECTION projection, double trimFraction, double* result) {
+	//columns are independent of each other, so every worker thread gets whole blocks of columns and writes to its own part of result
+	int threads = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+	int blocks = (width + COLUMN_PROJECTION_BLOCK_WIDTH - 1) / COLUMN_PROJECTION_BLOCK_WIDTH;
+	int bands = qMin(threads, blocks);
+	if (bands <= 1) {
+		return this->project(data, pixelType, stride, x, y, width, height, projection, trimFraction, result);
+	}
+	if (this->bandWorkspaces.size() < bands) {
+		this->bandWorkspaces.resize(bands);
+	}
+	QVector<ColumnProjectionBand> tasks(bands);
+	int blocksPerBand = blocks / bands;
+	for (int i = 0; i < bands; i++) {
+		tasks[i].x = i * blocksPerBand * COLUMN_PROJECTION_BLOCK_WIDTH;
+		tasks[i].width = (i == bands-1) ? width - tasks[i].x : blocksPerBand * COLUMN_PROJECTION_BLOCK_WIDTH;
+		tasks[i].workspace = &this->bandWorkspaces[i];
+		tasks[i].success = false;
+	}
+	QtConcurrent::blockingMap(tasks, [&](ColumnProjectionBand& band) {
+		band.success = projectRegion(*band.workspace, data, pixelType, stride, x + band.x, y, band.width, height, projection, trimFraction, result + band.x);
+	});
+	for (int i = 0; i < bands; i++) {
+		if (!tasks[i].success) {
+			return false;
+		}
+	}
+	return true;
+}
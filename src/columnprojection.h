@@ -0,0 +1,61 @@
+#ifndef COLUMNPROJECTION_H
+#define COLUMNPROJECTION_H
+
+#include <QtGlobal>
+#include <QVector>
+#include "pixeltype.h"
+
+#define COLUMN_PROJECTION_BLOCK_WIDTH 64 //number of columns that are gathered at once. the lines of a block are read sequentially and the columns of the block stay in L2 cache
+#define COLUMN_PROJECTION_HISTOGRAM_BLOCK_WIDTH 32 //number of columns whose histograms are built at once (8 and 16 bit samples without SIMD kernels)
+#define COLUMN_PROJECTION_SELECT_BLOCK_WIDTH 16 //number of columns whose ranks are selected at once by bisection, 16 bit keys of one line fill one AVX2 register
+#define COLUMN_PROJECTION_SELECT_MAX_ROWS 65535 //number of lines that can be counted in 16 bit integers by the bisection
+#define COLUMN_PROJECTION_DEFAULT_TRIM_FRACTION 0.1
+
+
+enum LINE_PROJECTION{
+	MEAN_PROJECTION, //arithmetic mean of all lines (column sums, see ColumnSum)
+	MEDIAN_PROJECTION, //median of each column, ignores saturated lines and flyback artifacts
+	TRIMMED_MEAN_PROJECTION, //mean of each column without the lowest and the highest values
+	MAX_PROJECTION //maximum of each column
+};
+
+
+//buffers of one thread of ColumnProjection. they only grow, so projecting the roi of every frame does not allocate heap memory
+struct ColumnProjectionWorkspace {
+	QVector<quint32> counts; //256 bin histograms of the (high byte of the) keys, one per column of a block
+	QVector<quint32> firstHistograms; //low byte histograms of the bin that contains the first rank
+	QVector<quint32> lastHistograms; //low byte histograms of the bin that contains the last rank
+	QVector<quint64> innerSums; //sums of the keys between these two bins
+	QVector<int> firstBins;
+	QVector<int> lastBins;
+	QVector<int> firstRanks;
+	QVector<int> lastRanks;
+	QVector<quint64> samples; //column major copy of a block of 32 bit and floating point samples. 64 bit elements keep every sample type aligned
+	QVector<quint16> keys; //keys of a band of 8 or 16 bit samples, one block of 16 columns after the other and line by line within a block. a block stays in L1 cache during the bisection
+};
+
+
+//column wise order statistics of a rectangular region of a frame, the robust alternatives to averaging all A-scans within the roi.
+//8 and 16 bit samples: the keys of a block of 16 columns are copied into a compact buffer, then the values with the needed ranks are found by bisection of the value range
+//of the block with SSE2/AVX2 compare and count passes over that buffer (one pass per bit of the value range). without SIMD kernels histograms of the keys are used instead (radix selection).
+//32 bit and floating point samples: a block of columns is copied line by line into a column major buffer, then every column is partially sorted with std::nth_element.
+//all are O(lines) per column and read the frame line by line. mean and maximum are calculated by the kernels of ColumnSum without copying.
+//the buffers are kept for the next call, so an object that is reused for every frame does not allocate heap memory
+class ColumnProjection
+{
+public:
+	//writes one value per column of lines y to y+height-1 and samples x to x+width-1 to result (result must have at least width elements). stride is the number of samples per line in data.
+	//trimFraction is the fraction of the lowest and also of the highest values of each column that is discarded by TRIMMED_MEAN_PROJECTION
+	bool project(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, LINE_PROJECTION projection, double trimFraction, double* result);
+
+	//same as project(..) but blocks of columns are processed by the threads of the global QThreadPool
+	bool projectParallel(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, LINE_PROJECTION projection, double trimFraction, double* result);
+
+private:
+	static bool projectRegion(ColumnProjectionWorkspace& workspace, const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, LINE_PROJECTION projection, double trimFraction, double* result);
+
+	ColumnProjectionWorkspace workspace; //used by project(..)
+	QVector<ColumnProjectionWorkspace> bandWorkspaces; //one per worker thread of projectParallel(..)
+};
+
+#endif //COLUMNPROJECTION_H
@@ -0,0 +1,494 @@
+#include "columnsum.h"
+#include <climits>
+#include <QVector>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLUMN_SUM_X86_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+//gcc and clang need a target attribute to emit AVX2 instructions in a single function without compiling the whole project with -mavx2. msvc does not need it
+#if defined(__GNUC__) || defined(__clang__)
+#define COLUMN_SUM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define COLUMN_SUM_TARGET_AVX2
+#endif
+
+
+//scalar kernel. data points to the first sample of the region, acc has width elements
+template<typename T, typename A>
+static void sumScalar(const T* data, size_t stride, int width, int height, A* acc) {
+	for (int y = 0; y < height; y++) {
+		const T* line = &data[static_cast<size_t>(y)*stride];
+		for (int x = 0; x < width; x++) {
+			acc[x] += line[x];
+		}
+	}
+}
+
+//scalar maximum kernel. acc has width elements and is initialized by the caller (e.g. with the first line)
+template<typename T>
+static void maxScalar(const T* data, size_t stride, int width, int height, T* acc) {
+	for (int y = 0; y < height; y++) {
+		const T* line = &data[static_cast<size_t>(y)*stride];
+		for (int x = 0; x < width; x++) {
+			acc[x] = qMax(acc[x], line[x]);
+		}
+	}
+}
+
+#ifdef COLUMN_SUM_X86_SIMD
+//SSE2 kernels. two lines are widened and added before the accumulators are updated, so each accumulator is loaded and stored only once per two lines
+static void sumU8Sse2(const quint8* data, size_t stride, int width, int height, quint32* acc) {
+	const __m128i zero = _mm_setzero_si128();
+	int vectorWidth = width & ~15;
+	int y = 0;
+	for (; y + 1 < height; y += 2) {
+		const quint8* line0 = &data[static_cast<size_t>(y)*stride];
+		const quint8* line1 = line0 + stride;
+		for (int x = 0; x < vectorWidth; x += 16) {
+			__m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line0 + x));
+			__m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line1 + x));
+			__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(v0, zero), _mm_unpacklo_epi8(v1, zero));
+			__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(v0, zero), _mm_unpackhi_epi8(v1, zero));
+			__m128i* a = reinterpret_cast<__m128i*>(acc + x);
+			_mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_unpacklo_epi16(lo, zero)));
+			_mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo, zero)));
+			_mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_unpacklo_epi16(hi, zero)));
+			_mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_unpackhi_epi16(hi, zero)));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] += static_cast<quint32>(line0[x]) + line1[x];
+		}
+	}
+	sumScalar(&data[static_cast<size_t>(y)*stride], stride, width, height - y, acc);
+}
+
+static void sumU16Sse2(const quint16* data, size_t stride, int width, int height, quint32* acc) {
+	const __m128i zero = _mm_setzero_si128();
+	int vectorWidth = width & ~7;
+	int y = 0;
+	for (; y + 1 < height; y += 2) {
+		const quint16* line0 = &data[static_cast<size_t>(y)*stride];
+		const quint16* line1 = line0 + stride;
+		for (int x = 0; x < vectorWidth; x += 8) {
+			__m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line0 + x));
+			__m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line1 + x));
+			__m128i lo = _mm_add_epi32(_mm_unpacklo_epi16(v0, zero), _mm_unpacklo_epi16(v1, zero));
+			__m128i hi = _mm_add_epi32(_mm_unpackhi_epi16(v0, zero), _mm_unpackhi_epi16(v1, zero));
+			__m128i* a = reinterpret_cast<__m128i*>(acc + x);
+			_mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), lo));
+			_mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), hi));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] += static_cast<quint32>(line0[x]) + line1[x];
+		}
+	}
+	sumScalar(&data[static_cast<size_t>(y)*stride], stride, width, height - y, acc);
+}
+
+static void sumU32Sse2(const quint32* data, size_t stride, int width, int height, quint64* acc) {
+	const __m128i zero = _mm_setzero_si128();
+	int vectorWidth = width & ~3;
+	for (int y = 0; y < height; y++) {
+		const quint32* line = &data[static_cast<size_t>(y)*stride];
+		for (int x = 0; x < vectorWidth; x += 4) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x));
+			__m128i* a = reinterpret_cast<__m128i*>(acc + x);
+			_mm_storeu_si128(a, _mm_add_epi64(_mm_loadu_si128(a), _mm_unpacklo_epi32(v, zero)));
+			_mm_storeu_si128(a + 1, _mm_add_epi64(_mm_loadu_si128(a + 1), _mm_unpackhi_epi32(v, zero)));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] += line[x];
+		}
+	}
+}
+
+//AVX2 kernels
+COLUMN_SUM_TARGET_AVX2
+static void sumU8Avx2(const quint8* data, size_t stride, int width, int height, quint32* acc) {
+	int vectorWidth = width & ~15;
+	int y = 0;
+	for (; y + 1 < height; y += 2) {
+		const quint8* line0 = &data[static_cast<size_t>(y)*stride];
+		const quint8* line1 = line0 + stride;
+		for (int x = 0; x < vectorWidth; x += 16) {
+			__m256i v = _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line0 + x))), _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line1 + x))));
+			__m256i* a = reinterpret_cast<__m256i*>(acc + x);
+			_mm256_storeu_si256(a, _mm256_add_epi32(_mm256_loadu_si256(a), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v))));
+			_mm256_storeu_si256(a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1))));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] += static_cast<quint32>(line0[x]) + line1[x];
+		}
+	}
+	sumScalar(&data[static_cast<size_t>(y)*stride], stride, width, height - y, acc);
+}
+
+COLUMN_SUM_TARGET_AVX2
+static void sumU16Avx2(const quint16* data, size_t stride, int width, int height, quint32* acc) {
+	int vectorWidth = width & ~15;
+	int y = 0;
+	for (; y + 1 < height; y += 2) {
+		const quint16* line0 = &data[static_cast<size_t>(y)*stride];
+		const quint16* line1 = line0 + stride;
+		for (int x = 0; x < vectorWidth; x += 16) {
+			__m256i lo = _mm256_add_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line0 + x))), _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line1 + x))));
+			__m256i hi = _mm256_add_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line0 + x + 8))), _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line1 + x + 8))));
+			__m256i* a = reinterpret_cast<__m256i*>(acc + x);
+			_mm256_storeu_si256(a, _mm256_add_epi32(_mm256_loadu_si256(a), lo));
+			_mm256_storeu_si256(a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1), hi));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] += static_cast<quint32>(line0[x]) + line1[x];
+		}
+	}
+	sumScalar(&data[static_cast<size_t>(y)*stride], stride, width, height - y, acc);
+}
+
+COLUMN_SUM_TARGET_AVX2
+static void sumU32Avx2(const quint32* data, size_t stride, int width, int height, quint64* acc) {
+	int vectorWidth = width & ~7;
+	for (int y = 0; y < height; y++) {
+		const quint32* line = &data[static_cast<size_t>(y)*stride];
+		for (int x = 0; x < vectorWidth; x += 8) {
+			__m256i* a = reinterpret_cast<__m256i*>(acc + x);
+			_mm256_storeu_si256(a, _mm256_add_epi64(_mm256_loadu_si256(a), _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x)))));
+			_mm256_storeu_si256(a + 1, _mm256_add_epi64(_mm256_loadu_si256(a + 1), _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x + 4)))));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] += line[x];
+		}
+	}
+}
+
+//maximum kernels. like the sum kernels two lines are combined before the accumulators are updated.
+//SSE2 has no unsigned 16 bit maximum, the samples are flipped to signed order (xor 0x8000) and flipped back when they are stored.
+//the floating point kernels keep the accumulator if a sample is NaN, as qMax(acc, sample) does
+static void maxU8Sse2(const quint8* data, size_t stride, int width, int height, quint8* acc) {
+	int vectorWidth = width & ~15;
+	int y = 0;
+	for (; y + 1 < height; y += 2) {
+		const quint8* line0 = &data[static_cast<size_t>(y)*stride];
+		const quint8* line1 = line0 + stride;
+		for (int x = 0; x < vectorWidth; x += 16) {
+			__m128i v = _mm_max_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line0 + x)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(line1 + x)));
+			__m128i* a = reinterpret_cast<__m128i*>(acc + x);
+			_mm_storeu_si128(a, _mm_max_epu8(_mm_loadu_si128(a), v));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] = qMax(acc[x], qMax(line0[x], line1[x]));
+		}
+	}
+	maxScalar(&data[static_cast<size_t>(y)*stride], stride, width, height - y, acc);
+}
+
+static void maxU16Sse2(const quint16* data, size_t stride, int width, int height, quint16* acc) {
+	const __m128i sign = _mm_set1_epi16(static_cast<short>(0x8000));
+	int vectorWidth = width & ~7;
+	int y = 0;
+	for (; y + 1 < height; y += 2) {
+		const quint16* line0 = &data[static_cast<size_t>(y)*stride];
+		const quint16* line1 = line0 + stride;
+		for (int x = 0; x < vectorWidth; x += 8) {
+			__m128i v0 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line0 + x)), sign);
+			__m128i v1 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line1 + x)), sign);
+			__m128i* a = reinterpret_cast<__m128i*>(acc + x);
+			__m128i m = _mm_max_epi16(_mm_xor_si128(_mm_loadu_si128(a), sign), _mm_max_epi16(v0, v1));
+			_mm_storeu_si128(a, _mm_xor_si128(m, sign));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] = qMax(acc[x], qMax(line0[x], line1[x]));
+		}
+	}
+	maxScalar(&data[static_cast<size_t>(y)*stride], stride, width, height - y, acc);
+}
+
+static void maxF32Sse2(const float* data, size_t stride, int width, int height, float* acc) {
+	int vectorWidth = width & ~3;
+	for (int y = 0; y < height; y++) {
+		const float* line = &data[static_cast<size_t>(y)*stride];
+		for (int x = 0; x < vectorWidth; x += 4) {
+			_mm_storeu_ps(acc + x, _mm_max_ps(_mm_loadu_ps(line + x), _mm_loadu_ps(acc + x)));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] = qMax(acc[x], line[x]);
+		}
+	}
+}
+
+COLUMN_SUM_TARGET_AVX2
+static void maxU8Avx2(const quint8* data, size_t stride, int width, int height, quint8* acc) {
+	int vectorWidth = width & ~31;
+	int y = 0;
+	for (; y + 1 < height; y += 2) {
+		const quint8* line0 = &data[static_cast<size_t>(y)*stride];
+		const quint8* line1 = line0 + stride;
+		for (int x = 0; x < vectorWidth; x += 32) {
+			__m256i v = _mm256_max_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(line0 + x)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line1 + x)));
+			__m256i* a = reinterpret_cast<__m256i*>(acc + x);
+			_mm256_storeu_si256(a, _mm256_max_epu8(_mm256_loadu_si256(a), v));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] = qMax(acc[x], qMax(line0[x], line1[x]));
+		}
+	}
+	maxScalar(&data[static_cast<size_t>(y)*stride], stride, width, height - y, acc);
+}
+
+COLUMN_SUM_TARGET_AVX2
+static void maxU16Avx2(const quint16* data, size_t stride, int width, int height, quint16* acc) {
+	int vectorWidth = width & ~15;
+	int y = 0;
+	for (; y + 1 < height; y += 2) {
+		const quint16* line0 = &data[static_cast<size_t>(y)*stride];
+		const quint16* line1 = line0 + stride;
+		for (int x = 0; x < vectorWidth; x += 16) {
+			__m256i v = _mm256_max_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(line0 + x)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line1 + x)));
+			__m256i* a = reinterpret_cast<__m256i*>(acc + x);
+			_mm256_storeu_si256(a, _mm256_max_epu16(_mm256_loadu_si256(a), v));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] = qMax(acc[x], qMax(line0[x], line1[x]));
+		}
+	}
+	maxScalar(&data[static_cast<size_t>(y)*stride], stride, width, height - y, acc);
+}
+
+COLUMN_SUM_TARGET_AVX2
+static void maxF32Avx2(const float* data, size_t stride, int width, int height, float* acc) {
+	int vectorWidth = width & ~7;
+	for (int y = 0; y < height; y++) {
+		const float* line = &data[static_cast<size_t>(y)*stride];
+		for (int x = 0; x < vectorWidth; x += 8) {
+			_mm256_storeu_ps(acc + x, _mm256_max_ps(_mm256_loadu_ps(line + x), _mm256_loadu_ps(acc + x)));
+		}
+		for (int x = vectorWidth; x < width; x++) {
+			acc[x] = qMax(acc[x], line[x]);
+		}
+	}
+}
+#endif //COLUMN_SUM_X86_SIMD
+
+//splits the region into chunks of columns (so the integer accumulators stay in L1 cache) and blocks of lines (so the integer accumulators can not overflow)
+//the integer sums are converted to double once per column and chunk
+template<typename T, typename A>
+static void accumulateInChunks(const T* data, size_t stride, int width, int height, double* sums, int maxRows, void (*kernel)(const T*, size_t, int, int, A*)) {
+	A acc[COLUMN_SUM_CHUNK_WIDTH];
+	for (int x = 0; x < width; x += COLUMN_SUM_CHUNK_WIDTH) {
+		int chunkWidth = qMin(COLUMN_SUM_CHUNK_WIDTH, width - x);
+		for (int y = 0; y < height; y += maxRows) {
+			int rows = qMin(maxRows, height - y);
+			for (int i = 0; i < chunkWidth; i++) {
+				acc[i] = 0;
+			}
+			kernel(&data[static_cast<size_t>(y)*stride + static_cast<size_t>(x)], stride, chunkWidth, rows, acc);
+			for (int i = 0; i < chunkWidth; i++) {
+				sums[x + i] += static_cast<double>(acc[i]);
+			}
+		}
+	}
+}
+
+
+//widened accumulator type for each sample type and the number of lines that can be summed up without overflow
+template<typename T> struct ColumnSumAccumulator {};
+template<> struct ColumnSumAccumulator<quint8> {typedef quint32 Type; static const int maxRows = COLUMN_SUM_MAX_ROWS_32BIT;};
+template<> struct ColumnSumAccumulator<quint16> {typedef quint32 Type; static const int maxRows = COLUMN_SUM_MAX_ROWS_32BIT;};
+template<> struct ColumnSumAccumulator<quint32> {typedef quint64 Type; static const int maxRows = INT_MAX;};
+template<> struct ColumnSumAccumulator<qint8> {typedef qint32 Type; static const int maxRows = COLUMN_SUM_MAX_ROWS_32BIT;};
+template<> struct ColumnSumAccumulator<qint16> {typedef qint32 Type; static const int maxRows = COLUMN_SUM_MAX_ROWS_32BIT;};
+template<> struct ColumnSumAccumulator<qint32> {typedef qint64 Type; static const int maxRows = INT_MAX;};
+template<> struct ColumnSumAccumulator<float> {typedef double Type; static const int maxRows = INT_MAX;};
+
+//kernel instantiation for one sample type, called via PixelType::dispatch
+template<typename T>
+struct ColumnSumKernel {
+	typedef typename ColumnSumAccumulator<T>::Type Accumulator;
+	typedef void (*Function)(const T*, size_t, int, int, Accumulator*);
+
+	static Function select(ColumnSum::INSTRUCTION_SET instructionSet) {
+		Q_UNUSED(instructionSet)
+		return sumScalar<T, Accumulator>;
+	}
+
+	static void run(const void* data, size_t stride, int width, int height, double* sums, ColumnSum::INSTRUCTION_SET instructionSet) {
+		accumulateInChunks<T, Accumulator>(static_cast<const T*>(data), stride, width, height, sums, ColumnSumAccumulator<T>::maxRows, select(instructionSet));
+	}
+};
+
+//maximum kernel instantiation for one sample type. the accumulators have the sample type and are initialized with the first line of each chunk
+template<typename T>
+struct ColumnMaxKernel {
+	typedef void (*Function)(const T*, size_t, int, int, T*);
+
+	static Function select(ColumnSum::INSTRUCTION_SET instructionSet) {
+		Q_UNUSED(instructionSet)
+		return maxScalar<T>;
+	}
+
+	static void run(const void* data, size_t stride, int width, int height, double* maxima, ColumnSum::INSTRUCTION_SET instructionSet) {
+		const T* samples = static_cast<const T*>(data);
+		Function kernel = select(instructionSet);
+		T acc[COLUMN_SUM_CHUNK_WIDTH];
+		for (int x = 0; x < width; x += COLUMN_SUM_CHUNK_WIDTH) {
+			int chunkWidth = qMin(COLUMN_SUM_CHUNK_WIDTH, width - x);
+			for (int i = 0; i < chunkWidth; i++) {
+				acc[i] = samples[x + i];
+			}
+			kernel(&samples[stride + static_cast<size_t>(x)], stride, chunkWidth, height - 1, acc);
+			for (int i = 0; i < chunkWidth; i++) {
+				maxima[x + i] = static_cast<double>(acc[i]);
+			}
+		}
+	}
+};
+
+#ifdef COLUMN_SUM_X86_SIMD
+template<>
+ColumnSumKernel<quint8>::Function ColumnSumKernel<quint8>::select(ColumnSum::INSTRUCTION_SET instructionSet) {
+	return instructionSet == ColumnSum::AVX2 ? sumU8Avx2 : instructionSet == ColumnSum::SSE2 ? sumU8Sse2 : sumScalar<quint8, quint32>;
+}
+
+template<>
+ColumnSumKernel<quint16>::Function ColumnSumKernel<quint16>::select(ColumnSum::INSTRUCTION_SET instructionSet) {
+	return instructionSet == ColumnSum::AVX2 ? sumU16Avx2 : instructionSet == ColumnSum::SSE2 ? sumU16Sse2 : sumScalar<quint16, quint32>;
+}
+
+template<>
+ColumnSumKernel<quint32>::Function ColumnSumKernel<quint32>::select(ColumnSum::INSTRUCTION_SET instructionSet) {
+	return instructionSet == ColumnSum::AVX2 ? sumU32Avx2 : instructionSet == ColumnSum::SSE2 ? sumU32Sse2 : sumScalar<quint32, quint64>;
+}
+
+template<>
+ColumnMaxKernel<quint8>::Function ColumnMaxKernel<quint8>::select(ColumnSum::INSTRUCTION_SET instructionSet) {
+	return instructionSet == ColumnSum::AVX2 ? maxU8Avx2 : instructionSet == ColumnSum::SSE2 ? maxU8Sse2 : maxScalar<quint8>;
+}
+
+template<>
+ColumnMaxKernel<quint16>::Function ColumnMaxKernel<quint16>::select(ColumnSum::INSTRUCTION_SET instructionSet) {
+	return instructionSet == ColumnSum::AVX2 ? maxU16Avx2 : instructionSet == ColumnSum::SSE2 ? maxU16Sse2 : maxScalar<quint16>;
+}
+
+template<>
+ColumnMaxKernel<float>::Function ColumnMaxKernel<float>::select(ColumnSum::INSTRUCTION_SET instructionSet) {
+	return instructionSet == ColumnSum::AVX2 ? maxF32Avx2 : instructionSet == ColumnSum::SSE2 ? maxF32Sse2 : maxScalar<float>;
+}
+#endif
+
+
+//lines y to y+height-1 of the region that is summed up by one worker thread of accumulateParallel(..)
+struct ColumnSumBand {
+	int y;
+	int height;
+	QVector<double> sums;
+	bool success;
+};
+
+
+bool ColumnSum::accumulate(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, double* sums) {
+	return accumulate(data, pixelType, stride, x, y, width, height, sums, getInstructionSet());
+}
+
+bool ColumnSum::accumulate(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, double* sums, INSTRUCTION_SET instructionSet) {
+	if (pixelType == PIXEL_INVALID) {
+		return false;
+	}
+	if (width <= 0 || height <= 0) {
+		return true;
+	}
+	size_t offset = (static_cast<size_t>(y)*static_cast<size_t>(stride) + static_cast<size_t>(x)) * PixelType::bytesPerSample(pixelType);
+	const void* regionData = &static_cast<const char*>(data)[offset];
+	return PixelType::dispatch<ColumnSumKernel>(pixelType, regionData, static_cast<size_t>(stride), width, height, sums, instructionSet);
+}
+
+bool ColumnSum::accumulateParallel(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, double* sums) {
+	int threads = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+	int bands = qMin(threads, height / COLUMN_SUM_MIN_ROWS_PER_TASK);
+	if (bands <= 1) {
+		return accumulate(data, pixelType, stride, x, y, width, height, sums);
+	}
+
+	//every band gets its own partial sums, so the worker threads never write to the same memory
+	QVector<ColumnSumBand> tasks(bands);
+	int linesPerBand = height / bands;
+	for (int i = 0; i < bands; i++) {
+		tasks[i].y = y + i*linesPerBand;
+		tasks[i].height = (i == bands-1) ? height - i*linesPerBand : linesPerBand;
+		tasks[i].sums.fill(0.0, width);
+		tasks[i].success = false;
+	}
+	INSTRUCTION_SET instructionSet = getInstructionSet();
+	QtConcurrent::blockingMap(tasks, [&](ColumnSumBand& band) {
+		band.success = accumulate(data, pixelType, stride, x, band.y, width, band.height, band.sums.data(), instructionSet);
+	});
+
+	//merge partial sums. integer data is summed exactly within each band, so the result does not depend on the number of bands
+	for (int i = 0; i < bands; i++) {
+		if (!tasks[i].success) {
+			return false;
+		}
+	}
+	for (int i = 0; i < bands; i++) {
+		const double* partialSums = tasks[i].sums.constData();
+		for (int j = 0; j < width; j++) {
+			sums[j] += partialSums[j];
+		}
+	}
+	return true;
+}
+
+bool ColumnSum::maximum(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, double* maxima) {
+	return maximum(data, pixelType, stride, x, y, width, height, maxima, getInstructionSet());
+}
+
+bool ColumnSum::maximum(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, double* maxima, INSTRUCTION_SET instructionSet) {
+	if (pixelType == PIXEL_INVALID) {
+		return false;
+	}
+	if (width <= 0 || height <= 0) {
+		return true;
+	}
+	size_t offset = (static_cast<size_t>(y)*static_cast<size_t>(stride) + static_cast<size_t>(x)) * PixelType::bytesPerSample(pixelType);
+	const void* regionData = &static_cast<const char*>(data)[offset];
+	return PixelType::dispatch<ColumnMaxKernel>(pixelType, regionData, static_cast<size_t>(stride), width, height, maxima, instructionSet);
+}
+
+ColumnSum::INSTRUCTION_SET ColumnSum::getInstructionSet() {
+	//cpu features are only detected once
+	static const INSTRUCTION_SET instructionSet = detectInstructionSet();
+	return instructionSet;
+}
+
+ColumnSum::INSTRUCTION_SET ColumnSum::detectInstructionSet() {
+#ifdef COLUMN_SUM_X86_SIMD
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return AVX2;
+	}
+#elif defined(_MSC_VER)
+	//AVX2 requires cpu support (cpuid leaf 7) and os support for saving ymm registers (xgetbv)
+	int cpuInfo[4];
+	__cpuid(cpuInfo, 0);
+	if (cpuInfo[0] >= 7) {
+		__cpuid(cpuInfo, 1);
+		bool osxsave = (cpuInfo[2] & (1 << 27)) != 0;
+		bool avx = (cpuInfo[2] & (1 << 28)) != 0;
+		__cpuidex(cpuInfo, 7, 0);
+		bool avx2 = (cpuInfo[1] & (1 << 5)) != 0;
+		if (osxsave && avx && avx2 && (_xgetbv(0) & 0x6) == 0x6) {
+			return AVX2;
+		}
+	}
+#endif
+	return SSE2;
+#else
+	return SCALAR;
+#endif
+}
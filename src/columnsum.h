@@ -0,0 +1,43 @@
+#ifndef COLUMNSUM_H
+#define COLUMNSUM_H
+
+#include <QtGlobal>
+#include "pixeltype.h"
+
+#define COLUMN_SUM_CHUNK_WIDTH 512 //number of columns that are summed up at once, integer accumulators of one chunk stay in L1 cache
+#define COLUMN_SUM_MAX_ROWS_32BIT 65536 //number of 8 bit or 16 bit lines that can be summed up in 32 bit integers without overflow
+#define COLUMN_SUM_MIN_ROWS_PER_TASK 64 //smallest band of lines that is summed up by one worker thread
+#define COLUMN_SUM_DEFAULT_PARALLEL_THRESHOLD 1048576 //number of samples (width*height) above which the parallel reduction is used
+
+
+//column wise sum of a rectangular region of a frame. this is the core operation of averaging all A-scans within the roi.
+//values are accumulated in widened integers with SSE2/AVX2 kernels (selected at runtime) and converted to double only once per column.
+//unsigned integer data uses the SIMD kernels, signed integer and floating point data the scalar kernel.
+//the column wise maximum (MAX_PROJECTION of ColumnProjection) uses the same chunks and kernel selection, there are SIMD kernels for 8/16 bit unsigned integers and floating point data
+class ColumnSum
+{
+public:
+	enum INSTRUCTION_SET {
+		SCALAR,
+		SSE2,
+		AVX2
+	};
+
+	//adds the values of lines y to y+height-1 and samples x to x+width-1 to sums (sums must have at least width elements). stride is the number of samples per line in data.
+	static bool accumulate(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, double* sums);
+	static bool accumulate(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, double* sums, INSTRUCTION_SET instructionSet);
+
+	//same as accumulate(..) but the lines are split into bands that are summed up by the threads of the global QThreadPool. the partial column sums are merged at the end
+	static bool accumulateParallel(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, double* sums);
+
+	//writes the maximum of lines y to y+height-1 of every column x to x+width-1 to maxima (maxima must have at least width elements)
+	static bool maximum(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, double* maxima);
+	static bool maximum(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, double* maxima, INSTRUCTION_SET instructionSet);
+
+	static INSTRUCTION_SET getInstructionSet();
+
+private:
+	static INSTRUCTION_SET detectInstructionSet();
+};
+
+#endif //COLUMNSUM_H
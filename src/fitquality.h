@@ -0,0 +1,75 @@
+#ifndef FITQUALITY_H
+#define FITQUALITY_H
+
+#include <QtGlobal>
+#include <QtMath>
+#include <QVector>
+#include <Eigen/Dense>
+
+
+//goodness of fit and 1 sigma uncertainties of a least squares fit. the uncertainties come from the covariance s^2*(J^T*J)^-1 with the J^T*J at the fitted
+//parameters, which levenbergMarquardt(..) already returns. apart from one pass over the data for R^2 nothing needs to be evaluated again
+struct FitQuality {
+	bool valid; //more samples than parameters and J^T*J is invertible
+	double rSquared; //1 - (sum of squared residuals)/(total sum of squares)
+	double reducedChiSquared; //sum of squared residuals/(samples - parameters), the estimated noise variance. residuals are not weighted also with a robust loss, so outliers count
+	double residualRms;
+	QVector<double> parameterSigma;
+	double peakPositionSigma;
+	double fwhmSigma;
+
+	FitQuality()
+		: valid(false),
+		rSquared(qQNaN()),
+		reducedChiSquared(qQNaN()),
+		residualRms(qQNaN()),
+		peakPositionSigma(qQNaN()),
+		fwhmSigma(qQNaN())
+	{
+	}
+
+	//cost is the sum of squared residuals. fwhmGradient is the derivative of the FWHM with respect to the parameters, positionIndex the parameter that is the peak position
+	template<typename MatrixType, typename VectorType>
+	static FitQuality calculate(const MatrixType& jtj, const VectorType& fwhmGradient, int positionIndex, double cost, const double* yData, int size) {
+		FitQuality quality;
+		int parameterCount = static_cast<int>(jtj.rows());
+		if (size <= 0 || !qIsFinite(cost)) {
+			return quality;
+		}
+		double mean = 0.0;
+		for (int i = 0; i < size; i++) {
+			mean += yData[i];
+		}
+		mean /= size;
+		double totalSumOfSquares = 0.0;
+		for (int i = 0; i < size; i++) {
+			totalSumOfSquares += (yData[i] - mean) * (yData[i] - mean);
+		}
+		quality.residualRms = qSqrt(cost / size);
+		quality.rSquared = totalSumOfSquares > 0.0 ? 1.0 - cost / totalSumOfSquares : qQNaN();
+		if (size <= parameterCount) {
+			return quality;
+		}
+		quality.reducedChiSquared = cost / (size - parameterCount);
+
+		//covariance of the parameters
+		Eigen::LDLT<MatrixType> ldlt(jtj);
+		if (ldlt.info() != Eigen::Success || !ldlt.isPositive()) {
+			return quality;
+		}
+		MatrixType covariance = ldlt.solve(MatrixType::Identity(parameterCount, parameterCount)) * quality.reducedChiSquared;
+		if (!covariance.allFinite()) {
+			return quality;
+		}
+		quality.parameterSigma.resize(parameterCount);
+		for (int i = 0; i < parameterCount; i++) {
+			quality.parameterSigma[i] = qSqrt(qMax(0.0, covariance(i, i)));
+		}
+		quality.peakPositionSigma = quality.parameterSigma.at(positionIndex);
+		quality.fwhmSigma = qSqrt(qMax(0.0, static_cast<double>(fwhmGradient.dot(covariance * fwhmGradient))));
+		quality.valid = true;
+		return quality;
+	}
+};
+
+#endif //FITQUALITY_H
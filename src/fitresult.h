@@ -0,0 +1,25 @@
+#ifndef FITRESULT_H
+#define FITRESULT_H
+
+#include <QtGlobal>
+#include <QMetaType>
+#include "fitquality.h"
+
+
+//result of one peak fit, emitted by PeakFit for every analyzed frame
+struct FitResult {
+	bool valid; //fit converged to a peak within the roi
+	double peakPosition;
+	double fwhm; //FWHM of the selected estimator (Gauss fit or half maximum). negative if not available
+	double halfMaxPeakPosition; //non-parametric estimate, NaN if not calculated
+	double halfMaxFwhm; //non-parametric estimate, negative if not calculated
+	int evaluations; //number of model evaluations
+	qint64 fitTimeUs; //wall-clock time of the fit
+	bool budgetExceeded; //fit was aborted because the time budget was used up. parameters are the best found until then
+	quint64 fitCount; //number of fits since start
+	quint64 budgetExceededCount; //number of fits that exceeded the time budget since start
+	FitQuality quality; //goodness of fit and uncertainties of peak position and FWHM. not valid if no model was fitted (half maximum estimator)
+};
+Q_DECLARE_METATYPE(FitResult)
+
+#endif //FITRESULT_H
@@ -0,0 +1,126 @@
+#include "framering.h"
+#include <cstdlib>
+
+#define SLOT_WRITING -1
+
+
+bool FrameSlot::acquire() {
+	return this->ring->acquireForRead(this);
+}
+
+void FrameSlot::release() {
+	this->ring->release(this);
+}
+
+
+FrameRing::FrameRing(int depth, FRAME_DROP_POLICY dropPolicy)
+	: depth(qBound(FRAME_RING_MIN_DEPTH, depth, FRAME_RING_MAX_DEPTH)),
+	dropPolicy(dropPolicy),
+	droppedFrames(0),
+	latestSequence(0),
+	writeIndex(0)
+{
+	this->frameSlots.resize(FRAME_RING_MAX_DEPTH);
+	for(int i = 0; i < FRAME_RING_MAX_DEPTH; i++){
+		FrameSlot* slot = new FrameSlot();
+		slot->content = FRAME_DATA;
+		slot->data = nullptr;
+		slot->capacity = 0;
+		slot->bytes = 0;
+		slot->pixelType = PIXEL_INVALID;
+		slot->bitDepth = 0;
+		slot->samplesPerLine = 0;
+		slot->linesPerFrame = 0;
+		slot->originX = 0;
+		slot->originY = 0;
+		slot->frameSamplesPerLine = 0;
+		slot->frameLinesPerFrame = 0;
+		slot->sequence = 0;
+		slot->fingerprint = ROI_FINGERPRINT_NONE;
+		slot->refCount.storeRelease(0);
+		slot->skipped.storeRelease(0);
+		slot->ring = this;
+		this->frameSlots[i] = slot;
+	}
+}
+
+FrameRing::~FrameRing() {
+	for(int i = 0; i < this->frameSlots.size(); i++){
+		if(this->frameSlots[i]->data != nullptr){
+			free(this->frameSlots[i]->data);
+		}
+		delete this->frameSlots[i];
+	}
+}
+
+void FrameRing::setDepth(int depth) {
+	//all slots are preallocated, so changing the depth only changes how many of them the producer cycles through. slots that are still in use stay valid.
+	this->depth.storeRelease(qBound(FRAME_RING_MIN_DEPTH, depth, FRAME_RING_MAX_DEPTH));
+}
+
+void FrameRing::setDropPolicy(FRAME_DROP_POLICY dropPolicy) {
+	this->dropPolicy.storeRelease(static_cast<int>(dropPolicy));
+}
+
+FrameSlot* FrameRing::acquireForWrite(size_t bytes) {
+	//find next free slot, starting after the most recently written one
+	int currentDepth = this->depth.loadAcquire();
+	FrameSlot* slot = nullptr;
+	for(int i = 0; i < currentDepth; i++){
+		int index = (this->writeIndex + i) % currentDepth;
+		if(this->frameSlots[index]->refCount.testAndSetAcquire(0, SLOT_WRITING)){
+			slot = this->frameSlots[index];
+			this->writeIndex = (index + 1) % currentDepth;
+			break;
+		}
+	}
+
+	//all slots are still in use by consumers: drop incoming frame instead of waiting
+	if(slot == nullptr){
+		this->droppedFrames.fetchAndAddRelaxed(1);
+		return nullptr;
+	}
+
+	//(re)allocate slot memory if necessary. this only happens if the frame size grows
+	if(slot->capacity < bytes){
+		if(slot->data != nullptr){
+			free(slot->data);
+		}
+		slot->data = malloc(bytes);
+		if(slot->data == nullptr){
+			slot->capacity = 0;
+			slot->refCount.storeRelease(0);
+			return nullptr;
+		}
+		slot->capacity = bytes;
+	}
+	slot->bytes = bytes;
+	slot->fingerprint = ROI_FINGERPRINT_NONE;
+	slot->skipped.storeRelease(0);
+
+	return slot;
+}
+
+void FrameRing::publish(FrameSlot* slot, int consumers) {
+	slot->sequence = this->latestSequence.fetchAndAddOrdered(1) + 1;
+	slot->refCount.storeRelease(qMax(0, consumers));
+}
+
+void FrameRing::cancelWrite(FrameSlot* slot) {
+	slot->refCount.storeRelease(0);
+}
+
+bool FrameRing::acquireForRead(FrameSlot* slot) {
+	//with DROP_OLDEST consumers skip frames for which a newer frame has already been published. a skipped frame is only counted once, even if several consumers skip it
+	if(this->getDropPolicy() == DROP_OLDEST && slot->sequence < this->latestSequence.loadAcquire()){
+		if(slot->skipped.testAndSetRelaxed(0, 1)){
+			this->droppedFrames.fetchAndAddRelaxed(1);
+		}
+		return false;
+	}
+	return true;
+}
+
+void FrameRing::release(FrameSlot* slot) {
+	slot->refCount.fetchAndSubOrdered(1);
+}
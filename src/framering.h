@@ -0,0 +1,89 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <QVector>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QMetaType>
+#include "pixeltype.h"
+#include "roifingerprint.h"
+
+#define FRAME_RING_MIN_DEPTH 3 //the fit keeps its last frame, fused reduction with visible display needs two more slots per frame
+#define FRAME_RING_MAX_DEPTH 16
+#define FRAME_RING_DEFAULT_DEPTH 4
+
+
+enum FRAME_DROP_POLICY{
+	DROP_NEWEST, //every published frame is processed, incoming frames are discarded if all slots are in use
+	DROP_OLDEST //consumers skip frames that have been superseded by a newer frame before they were processed
+};
+
+enum FRAME_SLOT_CONTENT{
+	FRAME_DATA, //samples of (a part of) a frame
+	COLUMN_SUMS //one double per sample position: sum over linesPerFrame lines starting at originY
+};
+
+class FrameRing;
+
+//a FrameSlot is handed to each consumer with one reference. Consumers must call release() exactly once when they are done with the data.
+//data may only contain a part of the frame (e.g. roi). samplesPerLine and linesPerFrame describe the stored data, originX/originY its position within the complete frame.
+struct FrameSlot {
+	FRAME_SLOT_CONTENT content;
+	void* data;
+	size_t capacity;
+	size_t bytes;
+	PIXEL_TYPE pixelType;
+	unsigned int bitDepth;
+	unsigned int samplesPerLine;
+	unsigned int linesPerFrame;
+	unsigned int originX;
+	unsigned int originY;
+	unsigned int frameSamplesPerLine;
+	unsigned int frameLinesPerFrame;
+	quint64 sequence;
+	quint64 fingerprint; //RoiFingerprint of the roi at ingest, ROI_FINGERPRINT_NONE if not calculated
+	QAtomicInt refCount;
+	QAtomicInt skipped;
+	FrameRing* ring;
+
+	bool acquire();
+	void release();
+};
+Q_DECLARE_METATYPE(FrameSlot*)
+
+
+//single-producer/multi-consumer ring of reference counted frame slots.
+//the producer never blocks: if no free slot is available the incoming frame is dropped and counted.
+//a slot is only written while its reference count is zero, so consumers never see torn data.
+class FrameRing
+{
+public:
+	FrameRing(int depth = FRAME_RING_DEFAULT_DEPTH, FRAME_DROP_POLICY dropPolicy = DROP_NEWEST);
+	~FrameRing();
+
+	void setDepth(int depth);
+	int getDepth() const {return this->depth.loadAcquire();}
+	void setDropPolicy(FRAME_DROP_POLICY dropPolicy);
+	FRAME_DROP_POLICY getDropPolicy() const {return static_cast<FRAME_DROP_POLICY>(this->dropPolicy.loadAcquire());}
+
+	//producer side
+	FrameSlot* acquireForWrite(size_t bytes);
+	void publish(FrameSlot* slot, int consumers);
+	void cancelWrite(FrameSlot* slot);
+
+	//consumer side
+	bool acquireForRead(FrameSlot* slot);
+	void release(FrameSlot* slot);
+
+	int getDroppedFrames() const {return this->droppedFrames.loadAcquire();}
+
+private:
+	QVector<FrameSlot*> frameSlots;
+	QAtomicInt depth;
+	QAtomicInt dropPolicy;
+	QAtomicInt droppedFrames;
+	QAtomicInteger<quint64> latestSequence;
+	int writeIndex;
+};
+
+#endif //FRAMERING_H
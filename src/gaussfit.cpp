@@ -1,25 +1,229 @@
 #include "gaussfit.h"
+#include "quadraticfit.h"
+#include "levenbergmarquardt.h"
+#include <limits>
+#include <QElapsedTimer>
 
-GaussFit::GaussFit(const Eigen::VectorXd &xDataInit, const Eigen::VectorXd &yDataInit)
-	: xData(xDataInit),
-	yData(yDataInit),
-	params(4),
-	gaussFunction(1.0, 1.0, 1.0, 1.0)
+GaussFit::GaussFit()
+	: size(0),
+	gaussFunction(1.0, 1.0, 1.0, 1.0),
+	evaluations(0),
+	estimateAcceptanceThreshold(0.0),
+	estimateAccepted(false),
+	cost(0.0),
+	timeBudgetUs(0),
+	budgetExceeded(false),
+	robustLoss(LEAST_SQUARES_LOSS)
 {
 	// Initial parameters for a, k, m, s
-	params << 10.0, 10.0, 10.0, 10.0;
+	this->params.setConstant(GAUSSFIT_DEFAULT_INITIAL_GUESS);
+	this->normalMatrix.setZero();
+}
+
+GaussFit::GaussFit(const Eigen::VectorXd &xDataInit, const Eigen::VectorXd &yDataInit)
+	: GaussFit()
+{
+	this->setData(xDataInit.data(), yDataInit.data(), static_cast<int>(qMin(xDataInit.size(), yDataInit.size())));
+}
+
+void GaussFit::setData(const double* xData, const double* yData, int size) {
+	//buffers only grow, smaller data sets use the first size elements
+	if (this->xData.size() < size) {
+		this->xData.resize(size);
+		this->yData.resize(size);
+	}
+	for (int i = 0; i < size; i++) {
+		this->xData[i] = xData[i];
+		this->yData[i] = yData[i];
+	}
+	this->size = size;
+}
+
+bool GaussFit::estimateInitialGuess() {
+	//samples above half maximum that are connected to the peak
+	PeakRegion region;
+	if (!this->findPeakRegion(0.5, region)) {
+		return false;
+	}
+	if (this->fitLogParabola(region)) {
+		return true;
+	}
+
+	//too few samples above half maximum for the parabola: centroid and width at half maximum (with linear interpolation of the edges)
+	int left = region.left;
+	int right = region.right;
+	double halfMax = region.threshold;
+	double weightSum = 0.0;
+	double centroid = 0.0;
+	for (int i = left; i <= right; i++) {
+		double weight = this->yData[i] - halfMax;
+		weightSum += weight;
+		centroid += weight * this->xData[i];
+	}
+	double leftEdge = this->xData[left];
+	double rightEdge = this->xData[right];
+	if (left > 0) {
+		double fraction = (this->yData[left] - halfMax) / (this->yData[left] - this->yData[left-1]);
+		leftEdge -= fraction * (this->xData[left] - this->xData[left-1]);
+	}
+	if (right < this->size-1) {
+		double fraction = (this->yData[right] - halfMax) / (this->yData[right] - this->yData[right+1]);
+		rightEdge += fraction * (this->xData[right+1] - this->xData[right]);
+	}
+	double fwhm = rightEdge - leftEdge;
+	if (!(weightSum > 0.0) || !(fwhm > 0.0)) {
+		return false;
+	}
+	this->params << region.maximum, region.offset, centroid / weightSum, fwhm / GAUSS_FWHM_FACTOR;
+	return true;
+}
+
+bool GaussFit::fitLogarithmic() {
+	this->evaluations = 0;
+	this->estimateAccepted = false;
+	this->budgetExceeded = false;
+	this->cost = std::numeric_limits<double>::infinity();
+
+	//in log space the Gaussian is a parabola: one weighted linear least squares fit with fixed cost per sample, no iterations
+	PeakRegion region;
+	bool success = this->findPeakRegion(GAUSSFIT_LOG_FIT_RELATIVE_HEIGHT, region) && this->fitLogParabola(region);
+	if (success) {
+		GaussFunctor functor(this->xData.data(), this->yData.data(), this->size);
+		GaussParams jtr;
+		this->cost = functor.normalEquations(this->params, this->normalMatrix, jtr);
+		this->evaluations++;
+	}
+
+	this->gaussFunction.setA(this->params[0]);
+	this->gaussFunction.setK(this->params[1]);
+	this->gaussFunction.setM(this->params[2]);
+	this->gaussFunction.setS(this->params[3]);
+	return success;
+}
+
+bool GaussFit::findPeakRegion(double relativeHeight, PeakRegion& region) const {
+	if (this->size < this->params.size()) {
+		return false;
+	}
+
+	//offset k from minimum, amplitude from maximum
+	int peakIndex = 0;
+	double yMin = this->yData[0];
+	double yMax = this->yData[0];
+	for (int i = 1; i < this->size; i++) {
+		if (this->yData[i] > yMax) {
+			yMax = this->yData[i];
+			peakIndex = i;
+		}
+		yMin = qMin(yMin, this->yData[i]);
+	}
+	double amplitude = yMax - yMin;
+	if (!(amplitude > 0.0)) {
+		return false;
+	}
+
+	//samples above threshold that are connected to the peak
+	region.peakIndex = peakIndex;
+	region.offset = yMin;
+	region.maximum = yMax;
+	region.threshold = yMin + relativeHeight * amplitude;
+	region.left = peakIndex;
+	region.right = peakIndex;
+	while (region.left > 0 && this->yData[region.left-1] > region.threshold) {
+		region.left--;
+	}
+	while (region.right < this->size-1 && this->yData[region.right+1] > region.threshold) {
+		region.right++;
+	}
+	return true;
+}
+
+bool GaussFit::fitLogParabola(const PeakRegion& region) {
+	//Caruana's algorithm: ln(y-k) of a Gaussian is a parabola. weighting with (y-k)^2 compensates the noise amplification of the logarithm for small values (Guo)
+	double k = region.offset;
+	double x0 = this->xData[region.peakIndex];
+	QuadraticFit parabola;
+	for (int i = region.left; i <= region.right; i++) {
+		double value = this->yData[i] - k;
+		parabola.addPoint(this->xData[i] - x0, qLn(value), value * value);
+	}
+	if (!parabola.solve() || parabola.getC2() >= 0.0) {
+		return false;
+	}
+	double c0 = parabola.getC0();
+	double c1 = parabola.getC1();
+	double c2 = parabola.getC2();
+	double s = qSqrt(-1.0 / (2.0 * c2));
+	double m = x0 - c1 / (2.0 * c2);
+	double a = k + qExp(c0 - c1 * c1 / (4.0 * c2));
+	if (!qIsFinite(s) || !qIsFinite(a) || m < this->xData[0] || m > this->xData[this->size-1]) {
+		return false;
+	}
+	this->params << a, k, m, s;
+	return true;
 }
 
 void GaussFit::fit() {
-	GaussFunctor functor(this->xData, this->yData);
-	Eigen::NumericalDiff<GaussFunctor> numDiff(functor);
-	Eigen::LevenbergMarquardt<Eigen::NumericalDiff<GaussFunctor>, double> lm(numDiff);
-	lm.parameters.maxfev = 10000;   // Maximum number of function evaluations
-	lm.parameters.xtol = 1e-6;    // Tolerance for the parameter change
-	lm.parameters.ftol = 1e-6;    // Tolerance for the cost function change
-	lm.parameters.gtol = 1e-6;    // Tolerance for the gradient
+	this->evaluations = 0;
+	this->estimateAccepted = false;
+	this->budgetExceeded = false;
+	QElapsedTimer timer;
+	timer.start();
+
+	//initial guess may already be good enough (e.g. closed-form estimate): rms of residuals relative to peak height below threshold. only checked for the unweighted fit
+	double acceptableCost = -1.0;
+	if (this->estimateAcceptanceThreshold > 0.0) {
+		double acceptableRms = this->estimateAcceptanceThreshold * qAbs(this->params[0] - this->params[1]);
+		acceptableCost = acceptableRms * acceptableRms * this->size;
+	}
+	GaussFunctor functor(this->xData.data(), this->yData.data(), this->size);
+	this->cost = levenbergMarquardt(functor, this->params, this->normalMatrix, this->timeBudgetUs, this->evaluations, this->budgetExceeded, acceptableCost);
+	//only the initial guess was evaluated and it was good enough
+	this->estimateAccepted = this->evaluations == 1 && this->cost <= acceptableCost;
 
-	lm.minimize(this->params);
+	//robust mode: iteratively reweighted least squares. samples with large residuals (side lobes, ghosts) get small weights and the fit is repeated.
+	//every refit starts at the previous result and usually converges within a few evaluations. weight buffers only grow, like the sample buffers. the weighted fits share the time budget of the first fit
+	bool reweighted = false;
+	if (this->robustLoss != LEAST_SQUARES_LOSS && !this->estimateAccepted && qIsFinite(this->cost)) {
+		if (this->robustWeights.size() < this->size) {
+			this->residuals.resize(this->size);
+			this->robustWeights.resize(this->size);
+			this->robustScratch.resize(this->size);
+		}
+		for (int iteration = 0; iteration < ROBUST_IRLS_MAX_ITERATIONS && !this->budgetExceeded; iteration++) {
+			GaussFunction currentFunction(this->params[0], this->params[1], this->params[2], this->params[3]);
+			for (int i = 0; i < this->size; i++) {
+				this->residuals[i] = this->yData[i] - currentFunction(this->xData[i]);
+			}
+			if (!RobustWeights::calculate(this->robustLoss, this->residuals.data(), this->robustScratch.data(), this->robustWeights.data(), this->size)) {
+				break;
+			}
+			int remainingUs = 0;
+			if (this->timeBudgetUs > 0) {
+				remainingUs = this->timeBudgetUs - static_cast<int>(timer.nsecsElapsed() / 1000);
+				if (remainingUs <= 0) {
+					this->budgetExceeded = true;
+					break;
+				}
+			}
+			GaussParams previousParams = this->params;
+			GaussFunctor weightedFunctor(this->xData.data(), this->yData.data(), this->size, this->robustWeights.data());
+			int weightedEvaluations = 0;
+			this->cost = levenbergMarquardt(weightedFunctor, this->params, this->normalMatrix, remainingUs, weightedEvaluations, this->budgetExceeded);
+			this->evaluations += weightedEvaluations;
+			reweighted = true;
+			if ((this->params - previousParams).norm() <= ROBUST_IRLS_TOLERANCE * this->params.norm()) {
+				break;
+			}
+		}
+	}
+
+	//cost and J^T*J of the weighted fit do not match the unweighted data that is used for R^2, chi^2 and the relative rms, so both are evaluated again without weights
+	if (reweighted) {
+		GaussParams jtr;
+		this->cost = functor.normalEquations(this->params, this->normalMatrix, jtr);
+		this->evaluations++;
+	}
 
 	this->gaussFunction.setA(this->params[0]);
 	this->gaussFunction.setK(this->params[1]);
@@ -27,6 +231,48 @@ void GaussFit::fit() {
 	this->gaussFunction.setS(this->params[3]);
 }
 
+void GaussFit::setInitialGuess(const GaussParams& params) {
+	this->params = params;
+}
+
+double GaussFit::getRelativeRms() const {
+	double peakHeight = qAbs(this->params[0] - this->params[1]);
+	if (this->size <= 0 || !(peakHeight > 0.0)) {
+		return std::numeric_limits<double>::infinity();
+	}
+	return qSqrt(this->cost / this->size) / peakHeight;
+}
+
+FitQuality GaussFit::getQuality() const {
+	//FWHM = GAUSS_FWHM_FACTOR*|s|
+	GaussParams fwhmGradient(0.0, 0.0, 0.0, this->params[3] < 0.0 ? -GAUSS_FWHM_FACTOR : GAUSS_FWHM_FACTOR);
+	return FitQuality::calculate(this->normalMatrix, fwhmGradient, 2, this->cost, this->yData.data(), this->size);
+}
+
+bool GaussFit::isValid() const {
+	if (this->size <= 0 || !qIsFinite(this->cost)) {
+		return false;
+	}
+	for (int i = 0; i < this->params.size(); i++) {
+		if (!qIsFinite(this->params[i])) {
+			return false;
+		}
+	}
+	return this->params[3] != 0.0 && this->params[2] >= this->xData[0] && this->params[2] <= this->xData[this->size-1];
+}
+
+void GaussFit::setTimeBudget(int timeBudgetUs) {
+	this->timeBudgetUs = timeBudgetUs;
+}
+
+void GaussFit::setRobustLoss(ROBUST_LOSS loss) {
+	this->robustLoss = loss;
+}
+
+void GaussFit::setEstimateAcceptanceThreshold(double threshold) {
+	this->estimateAcceptanceThreshold = threshold;
+}
+
 void GaussFit::setInitialGuessForA(double a) {
 	this->params[0] = a;
 }
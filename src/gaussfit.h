@@ -3,25 +3,76 @@
 
 #include "gaussfunction.h"
 #include "optimizationfunctor.h"
+#include "fitquality.h"
+#include "robustweights.h"
 #include <Eigen/Dense>
-#include <unsupported/Eigen/NonLinearOptimization>
-#include <unsupported/Eigen/NumericalDiff>
 #include <iostream>
 
+#define GAUSSFIT_DEFAULT_INITIAL_GUESS 10.0
+#define GAUSSFIT_LOG_FIT_RELATIVE_HEIGHT 0.2 //logarithmic fit uses the samples above this fraction of the peak height
+
+
+typedef Eigen::Matrix<double, 4, 1> GaussParams; // a, k, m, s
+
+//Levenberg-Marquardt fit of GaussFunction with the 4 parameters fixed at compile time, the iterations are the shared levenbergMarquardt(..) loop of levenbergmarquardt.h.
+//the 4x4 normal equations are accumulated sample by sample and solved in place. sample buffers are only reallocated if the number of samples grows,
+//so a GaussFit object that is reused for every frame does not allocate heap memory while fitting.
 class GaussFit {
 public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW //fixed-size Eigen members need aligned allocation if GaussFit is created with new
+
+	GaussFit();
 	GaussFit(const Eigen::VectorXd &xDataInit, const Eigen::VectorXd &yDataInit);
+	void setData(const double* xData, const double* yData, int size);
+	bool estimateInitialGuess(); //non-iterative estimate of all 4 parameters from the data (log-parabola or centroid/half maximum width)
 	void fit();
+	bool fitLogarithmic(); //weighted linear least squares fit of a parabola to ln(y-k), no iterations. fit() can be called afterwards to refine the result
+	void setInitialGuess(const GaussParams& params);
 	void setInitialGuessForA(double a);
 	void setInitialGuessForM(double m);
-	Eigen::VectorXd getParams() const { return this->params; }
+	void setTimeBudget(int timeBudgetUs); //fit() stops after timeBudgetUs microseconds and keeps the best parameters found so far. 0 disables
+	void setRobustLoss(ROBUST_LOSS loss); //LEAST_SQUARES_LOSS (default) or a robust loss, fit() then reweights the samples with RobustWeights and fits again
+	void setEstimateAcceptanceThreshold(double threshold); //fit() keeps the initial guess if rms(residuals)/(a-k) is below threshold. 0 disables
+	GaussParams getParams() const { return this->params; }
 	GaussFunction getGaussianFunction() const { return this->gaussFunction; }
+	int getEvaluations() const { return this->evaluations; }
+	bool isEstimateAccepted() const { return this->estimateAccepted; }
+	bool isBudgetExceeded() const { return this->budgetExceeded; }
+	double getCost() const { return this->cost; } //sum of squared residuals of the last fit, not weighted also if a robust loss is used
+	double getRelativeRms() const; //rms of residuals of the last fit relative to peak height a-k
+	FitQuality getQuality() const; //R^2, reduced chi^2 and parameter uncertainties of the last fit
+	bool isValid() const; //parameters of the last fit are finite and the peak lies within the data
 
 private:
-	Eigen::VectorXd xData;   // Data points x
+	//samples from left to right are connected to the peak and above threshold
+	struct PeakRegion {
+		int peakIndex;
+		int left;
+		int right;
+		double offset;
+		double maximum;
+		double threshold;
+	};
+
+	bool findPeakRegion(double relativeHeight, PeakRegion& region) const;
+	bool fitLogParabola(const PeakRegion& region);
+
+	Eigen::VectorXd xData;   // Data points x (only the first size elements are used)
 	Eigen::VectorXd yData;   // Observed values y
-	Eigen::VectorXd params;  // Parameters k, m, s
+	int size;
+	GaussParams params;  // Parameters a, k, m, s
 	GaussFunction gaussFunction;
+	int evaluations;
+	double estimateAcceptanceThreshold;
+	bool estimateAccepted;
+	double cost;
+	GaussFunctor::NormalMatrixType normalMatrix; //J^T*J at the fitted parameters, for the parameter uncertainties
+	int timeBudgetUs;
+	bool budgetExceeded;
+	ROBUST_LOSS robustLoss;
+	Eigen::VectorXd residuals; //buffers for robust reweighting, only grow like the sample buffers
+	Eigen::VectorXd robustWeights;
+	Eigen::VectorXd robustScratch;
 };
 
 #endif // GAUSSFIT_H
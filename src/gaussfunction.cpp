@@ -45,5 +45,5 @@ void GaussFunction::setS(double newS) {
 }
 
 double GaussFunction::getFWHM() {
-	return qAbs(2.354820045 * this->s); //info: 2*sqrt(2*ln(2)) ==  2.354820045
+	return qAbs(GAUSS_FWHM_FACTOR * this->s); //info: 2*sqrt(2*ln(2)) ==  2.354820045
 }
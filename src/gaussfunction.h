@@ -3,6 +3,8 @@
 
 #include <QtMath>
 
+#define GAUSS_FWHM_FACTOR 2.354820045 //2*sqrt(2*ln(2))
+
 class GaussFunction
 {
 public:
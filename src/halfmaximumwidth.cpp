@@ -0,0 +1,105 @@
+#include "halfmaximumwidth.h"
+#include <QtMath>
+
+#define HALF_MAX_CUBIC_BISECTION_STEPS 20
+
+
+HalfMaximumWidth::Result HalfMaximumWidth::calculate(const double* x, const double* y, int size, HALF_MAX_INTERPOLATION interpolation) {
+	Result result;
+	result.valid = false;
+	result.peakPosition = qQNaN();
+	result.peakValue = 0.0;
+	result.baseline = 0.0;
+	result.leftCrossing = qQNaN();
+	result.rightCrossing = qQNaN();
+	result.fwhm = -1.0;
+	if (size < 3) {
+		return result;
+	}
+
+	int peakIndex = 0;
+	double yMin = y[0];
+	double yMax = y[0];
+	for (int i = 1; i < size; i++) {
+		if (y[i] > yMax) {
+			yMax = y[i];
+			peakIndex = i;
+		}
+		yMin = qMin(yMin, y[i]);
+	}
+	if (!(yMax > yMin)) {
+		return result;
+	}
+	double spacing = (x[size-1] - x[0]) / (size - 1);
+	result.baseline = yMin;
+	result.peakValue = yMax;
+
+	//sub-sample peak position from a parabola through the maximum and its neighbours
+	double peakOffset = 0.0;
+	if (peakIndex > 0 && peakIndex < size-1) {
+		double denominator = y[peakIndex-1] - 2.0 * y[peakIndex] + y[peakIndex+1];
+		if (denominator < 0.0) {
+			peakOffset = 0.5 * (y[peakIndex-1] - y[peakIndex+1]) / denominator;
+		}
+	}
+	result.peakPosition = x[peakIndex] + peakOffset * spacing;
+
+	//walk from the peak to the first sample at or below half maximum on each side
+	double halfMax = yMin + 0.5 * (yMax - yMin);
+	int left = peakIndex;
+	while (left > 0 && y[left-1] > halfMax) {
+		left--;
+	}
+	int right = peakIndex;
+	while (right < size-1 && y[right+1] > halfMax) {
+		right++;
+	}
+	if (left == 0 || right == size-1) {
+		return result;
+	}
+
+	//crossings as fractional sample index, converted to x
+	double leftIndex = findCrossing(y, size, left, left-1, halfMax, interpolation);
+	double rightIndex = findCrossing(y, size, right, right+1, halfMax, interpolation);
+	result.leftCrossing = x[0] + leftIndex * spacing;
+	result.rightCrossing = x[0] + rightIndex * spacing;
+	result.fwhm = result.rightCrossing - result.leftCrossing;
+	result.valid = result.fwhm > 0.0;
+	return result;
+}
+
+double HalfMaximumWidth::findCrossing(const double* y, int size, int inside, int outside, double level, HALF_MAX_INTERPOLATION interpolation) {
+	//y[inside] > level >= y[outside], the two samples are neighbours
+	double fraction = (y[inside] - level) / (y[inside] - y[outside]);
+	double linearCrossing = inside + fraction * (outside - inside);
+	if (interpolation == LINEAR_INTERPOLATION) {
+		return linearCrossing;
+	}
+
+	//Catmull-Rom spline between samples i1 < i2 uses the neighbours i0 and i3. edge samples are repeated
+	int i1 = qMin(inside, outside);
+	int i2 = i1 + 1;
+	double p0 = y[qMax(0, i1-1)];
+	double p1 = y[i1];
+	double p2 = y[i2];
+	double p3 = y[qMin(size-1, i2+1)];
+	double c0 = p1;
+	double c1 = 0.5 * (p2 - p0);
+	double c2 = p0 - 2.5 * p1 + 2.0 * p2 - 0.5 * p3;
+	double c3 = 0.5 * (p3 - p0) + 1.5 * (p1 - p2);
+
+	//the spline passes through p1 and p2, so the crossing is bracketed within [0, 1]. bisection is robust even if the spline is not monotonic
+	double lower = 0.0;
+	double upper = 1.0;
+	bool risingAtLower = p1 < p2;
+	for (int i = 0; i < HALF_MAX_CUBIC_BISECTION_STEPS; i++) {
+		double t = 0.5 * (lower + upper);
+		double value = ((c3 * t + c2) * t + c1) * t + c0;
+		if ((value < level) == risingAtLower) {
+			lower = t;
+		} else {
+			upper = t;
+		}
+	}
+	return i1 + 0.5 * (lower + upper);
+}
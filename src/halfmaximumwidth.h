@@ -0,0 +1,34 @@
+#ifndef HALFMAXIMUMWIDTH_H
+#define HALFMAXIMUMWIDTH_H
+
+#include <QtGlobal>
+
+enum HALF_MAX_INTERPOLATION{
+	LINEAR_INTERPOLATION, //straight line between the two samples around the crossing
+	CUBIC_INTERPOLATION //Catmull-Rom spline through the four samples around the crossing
+};
+
+
+//non-parametric FWHM: the two half maximum crossings next to the peak are interpolated directly on the data. no model is fitted, so the width is also valid
+//for PSFs that are not Gaussian (e.g. side lobes caused by spectral windowing). runs in O(n): one pass for minimum and maximum and one walk from the peak to each crossing.
+class HalfMaximumWidth
+{
+public:
+	struct Result {
+		bool valid; //both crossings were found within the data
+		double peakPosition; //sub-sample position of the maximum (parabola through the three highest samples)
+		double peakValue;
+		double baseline; //minimum of the data
+		double leftCrossing;
+		double rightCrossing;
+		double fwhm;
+	};
+
+	//x values must be equally spaced and increasing
+	static Result calculate(const double* x, const double* y, int size, HALF_MAX_INTERPOLATION interpolation);
+
+private:
+	static double findCrossing(const double* y, int size, int inside, int outside, double level, HALF_MAX_INTERPOLATION interpolation);
+};
+
+#endif //HALFMAXIMUMWIDTH_H
@@ -36,7 +36,7 @@ ImageDisplay::ImageDisplay(QWidget *parent) : QGraphicsView(parent)
 	//setup bitconverter
 	this->bitConverter = new BitDepthConverter();
 	this->bitConverter->moveToThread(&converterThread);
-	connect(this, &ImageDisplay::non8bitFrameReceived, this->bitConverter, &BitDepthConverter::convertDataTo8bit);
+	connect(this, &ImageDisplay::non8bitFrameReceived, this->bitConverter, &BitDepthConverter::convertFrameTo8bit);
 	connect(this->bitConverter, &BitDepthConverter::info, this, &ImageDisplay::info);
 	connect(this->bitConverter, &BitDepthConverter::error, this, &ImageDisplay::error);
 	connect(this->bitConverter, &BitDepthConverter::converted8bitData, this, &ImageDisplay::displayFrame);
@@ -107,6 +107,16 @@ void ImageDisplay::wheelEvent(QWheelEvent* event) {
 	QGraphicsView::wheelEvent(event);
 }
 
+void ImageDisplay::showEvent(QShowEvent* event) {
+	emit visibilityChanged(true);
+	QGraphicsView::showEvent(event);
+}
+
+void ImageDisplay::hideEvent(QHideEvent* event) {
+	emit visibilityChanged(false);
+	QGraphicsView::hideEvent(event);
+}
+
 void ImageDisplay::scaleView(qreal scaleFactor) {
 	qreal factor = transform().scale(scaleFactor, scaleFactor).mapRect(QRectF(0, 0, 1, 1)).width();
 	if (factor < 0.07 || factor > 100){
@@ -123,14 +133,17 @@ void ImageDisplay::zoomOut() {
 	this->scaleView(1/qreal(1.2));
 }
 
-void ImageDisplay::receiveFrame(void *frame, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame) {
-	if(!this->isVisible()){
+void ImageDisplay::receiveFrame(FrameSlot* frame) {
+	if(!this->isVisible() || !frame->acquire()){
+		frame->release();
 		return;
 	}
-	if(bitDepth != 8){
-		emit non8bitFrameReceived(frame, bitDepth, samplesPerLine, linesPerFrame);
+	if(frame->pixelType != PIXEL_UINT8 || frame->bitDepth != 8){
+		//reference to frame is passed on to bit converter and released there
+		emit non8bitFrameReceived(frame);
 	}else{
-		this->displayFrame(static_cast<uchar*>(frame), samplesPerLine, linesPerFrame);
+		this->displayFrame(static_cast<uchar*>(frame->data), frame->samplesPerLine, frame->linesPerFrame);
+		frame->release();
 	}
 }
 
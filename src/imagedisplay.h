@@ -9,6 +9,7 @@
 #include <QWheelEvent>
 #include <QtMath>
 #include "bitdepthconverter.h"
+#include "framering.h"
 #include "rectoverlay.h"
 
 class ImageDisplay : public QGraphicsView
@@ -30,6 +31,10 @@ private:
 	void wheelEvent(QWheelEvent* event) override;
 	void scaleView(qreal scaleFactor);
 
+protected:
+	void showEvent(QShowEvent* event) override;
+	void hideEvent(QHideEvent* event) override;
+
 private:
 	BitDepthConverter* bitConverter;
 	QGraphicsScene* scene;
@@ -44,13 +49,14 @@ private:
 public slots:
 	void zoomIn();
 	void zoomOut();
-	void receiveFrame(void* frame, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	void receiveFrame(FrameSlot* frame);
 	void displayFrame(uchar* frame, unsigned int samplesPerLine, unsigned int linesPerFrame);
 	void setRoi(QRect roi);
 
 signals:
-	void non8bitFrameReceived(void *frame, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	void non8bitFrameReceived(FrameSlot* frame);
 	void roiChanged(QRect);
+	void visibilityChanged(bool visible);
 	void info(QString);
 	void error(QString);
 
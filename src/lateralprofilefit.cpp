@@ -0,0 +1,166 @@
+#include "lateralprofilefit.h"
+#include "psfmodelregistry.h"
+#include <QThreadPool>
+#include <QtConcurrent>
+
+
+//converts one line of samples to double, called via PixelType::dispatch
+template<typename T>
+struct LineConversionKernel {
+	static void run(const void* data, int width, double* line) {
+		const T* samples = static_cast<const T*>(data);
+		for (int i = 0; i < width; i++) {
+			line[i] = static_cast<double>(samples[i]);
+		}
+	}
+};
+
+
+LateralProfileFit::LateralProfileFit()
+	: modelName(PSF_MODEL_DEFAULT),
+	robustLoss(LEAST_SQUARES_LOSS),
+	warmStartEnabled(true),
+	timeBudgetUs(0)
+{
+
+}
+
+LateralProfileFit::~LateralProfileFit() {
+	this->clearBands();
+}
+
+void LateralProfileFit::setModel(const QString& name) {
+	QString registeredName = PsfModelRegistry::instance().contains(name) ? name : QString(PSF_MODEL_DEFAULT);
+	if (registeredName == this->modelName) {
+		return;
+	}
+	this->modelName = registeredName;
+	this->clearBands();
+}
+
+void LateralProfileFit::setRobustLoss(ROBUST_LOSS loss) {
+	this->robustLoss = loss;
+}
+
+void LateralProfileFit::setWarmStartEnabled(bool enabled) {
+	this->warmStartEnabled = enabled;
+}
+
+void LateralProfileFit::setTimeBudget(int timeBudgetUs) {
+	this->timeBudgetUs = timeBudgetUs;
+}
+
+bool LateralProfileFit::fit(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, QVector<qreal>& peakPositions, QVector<qreal>& fwhms) {
+	if (pixelType == PIXEL_INVALID || data == nullptr) {
+		return false;
+	}
+	peakPositions.fill(qQNaN(), qMax(0, height));
+	fwhms.fill(qQNaN(), qMax(0, height));
+	if (width <= 0 || height <= 0) {
+		return true;
+	}
+
+	//number of bands only changes with the roi height or the thread pool size. fit objects of existing bands are reused
+	int threads = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+	int bandCount = qBound(1, height / LATERAL_PROFILE_MIN_LINES_PER_TASK, threads);
+	if (this->bands.size() != bandCount) {
+		this->clearBands();
+		this->bands.resize(bandCount);
+		for (int i = 0; i < bandCount; i++) {
+			this->bands[i].fit = PsfModelRegistry::instance().create(this->modelName);
+		}
+	}
+	int linesPerBand = height / bandCount;
+	for (int i = 0; i < bandCount; i++) {
+		Band& band = this->bands[i];
+		band.y = i*linesPerBand;
+		band.height = (i == bandCount-1) ? height - i*linesPerBand : linesPerBand;
+		band.validFits = 0;
+		band.evaluations = 0;
+		if (band.fit == nullptr) {
+			return false;
+		}
+		band.fit->setRobustLoss(this->robustLoss);
+		band.fit->setTimeBudget(this->timeBudgetUs);
+	}
+
+	//every band writes only to its own lines of the result, so the worker threads never write to the same memory
+	const char* regionData = &static_cast<const char*>(data)[static_cast<size_t>(y)*static_cast<size_t>(stride)*PixelType::bytesPerSample(pixelType)];
+	qreal* positionData = peakPositions.data();
+	qreal* fwhmData = fwhms.data();
+	if (bandCount > 1) {
+		QtConcurrent::blockingMap(this->bands, [&](Band& band) {
+			this->fitBand(band, regionData, pixelType, stride, x, width, positionData, fwhmData);
+		});
+	} else {
+		this->fitBand(this->bands[0], regionData, pixelType, stride, x, width, positionData, fwhmData);
+	}
+	return true;
+}
+
+int LateralProfileFit::getValidFits() const {
+	int validFits = 0;
+	for (int i = 0; i < this->bands.size(); i++) {
+		validFits += this->bands.at(i).validFits;
+	}
+	return validFits;
+}
+
+int LateralProfileFit::getEvaluations() const {
+	int evaluations = 0;
+	for (int i = 0; i < this->bands.size(); i++) {
+		evaluations += this->bands.at(i).evaluations;
+	}
+	return evaluations;
+}
+
+void LateralProfileFit::fitBand(Band& band, const char* data, PIXEL_TYPE pixelType, int stride, int x, int width, qreal* peakPositions, qreal* fwhms) {
+	//sample buffers only grow
+	if (band.xData.size() < width) {
+		band.xData.resize(width);
+		band.yData.resize(width);
+	}
+	for (int i = 0; i < width; i++) {
+		band.xData[i] = x + i;
+	}
+
+	//the first line of a band has no neighbor and is fitted with a cold start. a warm start keeps offset and shape of the neighboring A-scan
+	//and only estimates peak value and position of the current line. if the residual jumps the fit is repeated with a cold start
+	size_t bytesPerSample = PixelType::bytesPerSample(pixelType);
+	bool neighborValid = false;
+	double neighborRelativeRms = 0.0;
+	for (int line = band.y; line < band.y + band.height; line++) {
+		const char* lineData = &data[(static_cast<size_t>(line)*static_cast<size_t>(stride) + static_cast<size_t>(x))*bytesPerSample];
+		PixelType::dispatch<LineConversionKernel>(pixelType, static_cast<const void*>(lineData), width, band.yData.data());
+		band.fit->setData(band.xData.constData(), band.yData.constData(), width);
+
+		//a rejected warm start is never used as result: if the cold estimate fails as well the line stays invalid
+		bool fitted = false;
+		if (this->warmStartEnabled && neighborValid && band.fit->estimateInitialGuess(true)) {
+			band.fit->fit();
+			band.evaluations += band.fit->getEvaluations();
+			fitted = band.fit->isValid() && band.fit->getRelativeRms() <= neighborRelativeRms * LATERAL_PROFILE_WARM_START_MAX_RESIDUAL_INCREASE;
+		}
+		if (!fitted && band.fit->estimateInitialGuess(false)) {
+			band.fit->fit();
+			band.evaluations += band.fit->getEvaluations();
+			fitted = true;
+		}
+
+		//line without peak: the fit object still holds the result of the neighbor or of the rejected warm start
+		neighborValid = fitted && band.fit->isValid();
+		if (neighborValid) {
+			neighborRelativeRms = band.fit->getRelativeRms();
+			peakPositions[line] = band.fit->getPeakPosition();
+			fwhms[line] = band.fit->getFWHM();
+			band.validFits++;
+		}
+	}
+}
+
+void LateralProfileFit::clearBands() {
+	for (int i = 0; i < this->bands.size(); i++) {
+		delete this->bands[i].fit;
+	}
+	this->bands.clear();
+}
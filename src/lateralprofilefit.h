@@ -0,0 +1,57 @@
+#ifndef LATERALPROFILEFIT_H
+#define LATERALPROFILEFIT_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QString>
+#include "pixeltype.h"
+#include "robustweights.h"
+#include "psfmodelfit.h"
+
+#define LATERAL_PROFILE_MIN_LINES_PER_TASK 16 //smallest band of A-scans that is fitted by one worker thread
+#define LATERAL_PROFILE_WARM_START_MAX_RESIDUAL_INCREASE 1.5 //warm started fit is repeated with a cold start if its relative rms residual is larger than the one of the neighboring A-scan by this factor
+
+
+//fits every A-scan of the roi independently to get FWHM and peak position as function of the lateral position (field curvature, focus variation across the scan).
+//the lines are split into bands that are fitted by the threads of the global QThreadPool. within a band every fit starts at the result of the neighboring
+//A-scan, which only differs slightly. fit objects and sample buffers of the bands are kept for the next frame, so fitting does not allocate heap memory
+class LateralProfileFit
+{
+public:
+	LateralProfileFit();
+	~LateralProfileFit();
+
+	void setModel(const QString& name); //name of a model of the PsfModelRegistry
+	void setRobustLoss(ROBUST_LOSS loss);
+	void setWarmStartEnabled(bool enabled);
+	void setTimeBudget(int timeBudgetUs); //time budget of every single line fit, see AbstractPsfModelFit::setTimeBudget(..). 0 disables
+
+	//fits lines y to y+height-1, samples x to x+width-1. stride is the number of samples per line in data. peakPositions and fwhms get one value per line, NaN if the fit failed
+	bool fit(const void* data, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height, QVector<qreal>& peakPositions, QVector<qreal>& fwhms);
+
+	int getValidFits() const; //number of lines of the last call of fit(..) with a valid result
+	int getEvaluations() const; //sum of function evaluations of all lines of the last call of fit(..)
+
+private:
+	//lines y to y+height-1 of the roi that are fitted by one worker thread
+	struct Band {
+		int y;
+		int height;
+		AbstractPsfModelFit* fit;
+		QVector<double> xData;
+		QVector<double> yData;
+		int validFits;
+		int evaluations;
+	};
+
+	void fitBand(Band& band, const char* data, PIXEL_TYPE pixelType, int stride, int x, int width, qreal* peakPositions, qreal* fwhms);
+	void clearBands();
+
+	QVector<Band> bands;
+	QString modelName;
+	ROBUST_LOSS robustLoss;
+	bool warmStartEnabled;
+	int timeBudgetUs;
+};
+
+#endif //LATERALPROFILEFIT_H
@@ -0,0 +1,103 @@
+#ifndef LEVENBERGMARQUARDT_H
+#define LEVENBERGMARQUARDT_H
+
+#include <QtGlobal>
+#include <QtMath>
+#include <QElapsedTimer>
+#include <Eigen/Dense>
+#include <limits>
+
+#define LM_MAX_EVALUATIONS 10000 //cost and normal equation evaluations of one fit
+#define LM_TOLERANCE 1e-6 //relative step size, cost reduction and gradient at which the fit is converged
+
+
+//Levenberg-Marquardt loop of GaussFit, PsfModelFit and PsfMultiPeakFit. FunctorType provides values(), cost(..), normalEquations(..) and constrain(..) (see optimizationfunctor.h).
+//the normal equations are accumulated sample by sample by the functor, so the loop itself only works on the small fixed-size matrices of the parameters.
+//params is the initial guess and the result, jtj is J^T*J at the resulting params. returns the sum of squared residuals, infinity if there are fewer samples than parameters.
+//if the cost of the initial guess is at most acceptableCost, params is returned unchanged after one evaluation (e.g. closed-form estimate is already good enough). a negative acceptableCost always iterates
+template<typename FunctorType>
+double levenbergMarquardt(const FunctorType& functor, typename FunctorType::InputType& params, typename FunctorType::NormalMatrixType& jtj, int timeBudgetUs, int& evaluations, bool& budgetExceeded, double acceptableCost = -1.0) {
+	typedef typename FunctorType::InputType ParamsType;
+	typedef typename FunctorType::NormalMatrixType MatrixType;
+	evaluations = 0;
+	budgetExceeded = false;
+	QElapsedTimer timer;
+	timer.start();
+	qint64 budgetNs = static_cast<qint64>(timeBudgetUs) * 1000;
+	int parameterCount = static_cast<int>(params.size());
+
+	//at least as many samples as parameters are needed
+	if (functor.values() < parameterCount) {
+		return std::numeric_limits<double>::infinity();
+	}
+	ParamsType jtr;
+	double cost = functor.normalEquations(params, jtj, jtr);
+	double lambda = 1e-3;
+	evaluations++;
+
+	bool converged = cost <= acceptableCost;
+	bool jtjAtParams = true; //false after the last accepted step, the normal equations are not needed for another step then
+	while (!converged && !budgetExceeded && evaluations < LM_MAX_EVALUATIONS) {
+		//gradient check: cosine between residual vector and each Jacobian column
+		double gradientNorm = 0.0;
+		for (int i = 0; i < parameterCount; i++) {
+			double columnNorm = qSqrt(jtj(i, i) * cost);
+			if (columnNorm > 0.0) {
+				gradientNorm = qMax(gradientNorm, qAbs(jtr[i]) / columnNorm);
+			}
+		}
+		if (gradientNorm <= LM_TOLERANCE) {
+			break;
+		}
+
+		//damped step (J^T*J + lambda*diag(J^T*J)) * step = -J^T*fvec. lambda is increased until the step reduces the cost
+		bool stepAccepted = false;
+		while (!stepAccepted && evaluations < LM_MAX_EVALUATIONS) {
+			//wall-clock deadline: abort with the best parameters found so far
+			if (budgetNs > 0 && timer.nsecsElapsed() > budgetNs) {
+				budgetExceeded = true;
+				break;
+			}
+			MatrixType dampedJtj = jtj;
+			for (int i = 0; i < parameterCount; i++) {
+				dampedJtj(i, i) += lambda * qMax(jtj(i, i), 1e-12);
+			}
+			ParamsType step = dampedJtj.ldlt().solve(-jtr);
+			ParamsType candidate = params + step;
+			functor.constrain(candidate);
+			double candidateCost = functor.cost(candidate);
+			evaluations++;
+
+			if (qIsFinite(candidateCost) && candidateCost < cost) {
+				stepAccepted = true;
+				params = candidate;
+				lambda = qMax(lambda * 0.1, 1e-15);
+				bool smallStep = step.norm() <= LM_TOLERANCE * (params.norm() + LM_TOLERANCE);
+				bool smallReduction = (cost - candidateCost) <= LM_TOLERANCE * cost;
+				converged = smallStep || smallReduction;
+				cost = candidateCost;
+				jtjAtParams = !converged;
+				if (!converged) {
+					cost = functor.normalEquations(params, jtj, jtr);
+					evaluations++;
+				}
+			} else {
+				lambda *= 10.0;
+				//no step in any direction reduces the cost anymore: parameters are at a minimum
+				if (lambda > 1e16) {
+					converged = true;
+					break;
+				}
+			}
+		}
+	}
+
+	//J^T*J is used for the parameter uncertainties, so it has to belong to the returned parameters and not to the iterate before the last step
+	if (!jtjAtParams) {
+		cost = functor.normalEquations(params, jtj, jtr);
+		evaluations++;
+	}
+	return cost;
+}
+
+#endif //LEVENBERGMARQUARDT_H
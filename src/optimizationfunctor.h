@@ -2,9 +2,8 @@
 #define OPTIMIZATIONFUNCTOR_H
 
 #include <Eigen/Dense>
-#include <unsupported/Eigen/NonLinearOptimization>
-#include <unsupported/Eigen/NumericalDiff>
 #include "gaussfunction.h"
+#include "psfmodel.h"
 
 /***********************************************************************************************/
 //this code is adapted from a stackoverflow post by MattKelly.
@@ -45,25 +44,220 @@ struct Functor
 /***********************************************************************************************/
 
 // Functor for the Gauss function
-struct GaussFunctor : Functor<double>
+// The 4 parameters a, k, m, s are fixed at compile time. The data is not copied, the functor only maps the sample buffers of the caller
+// Optional weights (one per sample, e.g. from robust reweighting) scale the squared residuals. nullptr means all weights are 1
+struct GaussFunctor : Functor<double, 4>
 {
+	typedef Eigen::Map<const Eigen::VectorXd> DataType;
+	typedef Eigen::Matrix<double, 4, 4> NormalMatrixType;
+
 	// Constructor
-	GaussFunctor(const Eigen::VectorXd& xData, const Eigen::VectorXd& yData)
-		: Functor<double>(4, xData.size()), xData(xData), yData(yData) {}
+	GaussFunctor(const double* xData, const double* yData, int values, const double* weights = nullptr)
+		: Functor<double, 4>(4, values), xData(xData, values), yData(yData, values), weights(weights) {}
 
-	// Implementation of the objective function
-	int operator()(const Eigen::VectorXd &params, Eigen::VectorXd &fvec) const {
-		// Create an instance of GaussFunction with current parameters
+	// Sum of (weighted) squared residuals
+	double cost(const InputType &params) const {
 		GaussFunction gaussFunction(params[0], params[1], params[2], params[3]);
+		double sum = 0.0;
+		for (int i = 0; i < xData.size(); ++i) {
+			double residual = yData[i] - gaussFunction(xData[i]);
+			sum += this->weight(i) * residual * residual;
+		}
+		return sum;
+	}
+
+	// Accumulates J^T*J and J^T*fvec sample by sample, so the Jacobian with one row per sample is never stored. Returns the sum of squared residuals
+	double normalEquations(const InputType &params, NormalMatrixType &jtj, InputType &jtr) const {
+		jtj.setZero();
+		jtr.setZero();
+		double sum = 0.0;
+		InputType row;
+		for (int i = 0; i < xData.size(); ++i) {
+			double residual;
+			this->jacobianRow(params, i, row[0], row[1], row[2], row[3], residual);
+			double w = this->weight(i);
+			jtj.noalias() += w * row * row.transpose();
+			jtr += (w * residual) * row;
+			sum += w * residual * residual;
+		}
+		return sum;
+	}
+
+	// Parameters are not constrained, a negative s describes the same Gaussian
+	void constrain(InputType &params) const {
+		Q_UNUSED(params);
+	}
+
+	DataType xData;
+	DataType yData;
+	const double* weights;
+
+private:
+	double weight(int i) const { return this->weights != nullptr ? this->weights[i] : 1.0; }
+
+	// Analytic gradient of residual[i] = y[i] - (k + (a-k)*e[i]) with e[i] = exp(-(x[i]-m)^2/(2s^2)), only one qExp per sample is needed
+	void jacobianRow(const InputType &params, int i, double &da, double &dk, double &dm, double &ds, double &residual) const {
+		const double a = params[0];
+		const double k = params[1];
+		const double m = params[2];
+		const double s = params[3];
+		const double s2 = s * s;
+		const double dx = xData[i] - m;
+		const double e = qExp(-(dx * dx) / (2.0 * s2));
+		const double amplitudeTerm = (a - k) * e * dx / s2;
+		da = -e;
+		dk = e - 1.0;
+		dm = -amplitudeTerm;
+		ds = -amplitudeTerm * dx / s;
+		residual = yData[i] - (k + (a - k) * e);
+	}
+};
+
+/***********************************************************************************************/
+
+// Functor for any PSF model of psfmodel.h
+// Same as GaussFunctor, but value and gradient come from the model. The number of parameters is fixed at compile time by the model, so every model gets its own specialization
+template<typename Model>
+struct PsfModelFunctor : Functor<double, Model::ParameterCount>
+{
+	typedef Functor<double, Model::ParameterCount> Base;
+	typedef typename Base::InputType InputType;
+	typedef Eigen::Map<const Eigen::VectorXd> DataType;
+	typedef Eigen::Matrix<double, Model::ParameterCount, Model::ParameterCount> NormalMatrixType;
+
+	PsfModelFunctor(const double* xData, const double* yData, int values, const double* weights = nullptr)
+		: Base(Model::ParameterCount, values), xData(xData, values), yData(yData, values), weights(weights) {}
+
+	// Sum of (weighted) squared residuals
+	double cost(const InputType &params) const {
+		double sum = 0.0;
+		for (int i = 0; i < xData.size(); ++i) {
+			double residual = yData[i] - Model::value(params, xData[i]);
+			sum += this->weight(i) * residual * residual;
+		}
+		return sum;
+	}
+
+	// J^T*J and J^T*fvec with fvec[i] = y[i] - model(x[i]), so the Jacobian row is the negative model gradient. Returns the sum of squared residuals
+	double normalEquations(const InputType &params, NormalMatrixType &jtj, InputType &jtr) const {
+		jtj.setZero();
+		jtr.setZero();
+		double sum = 0.0;
+		InputType gradient;
 		for (int i = 0; i < xData.size(); ++i) {
-			fvec[i] = yData[i] - gaussFunction(xData[i]);
+			double residual = yData[i] - Model::valueAndGradient(params, xData[i], gradient);
+			double w = this->weight(i);
+			jtj.noalias() += w * gradient * gradient.transpose();
+			jtr -= (w * residual) * gradient;
+			sum += w * residual * residual;
 		}
+		return sum;
+	}
 
-		return 0;
+	void constrain(InputType &params) const {
+		Model::constrain(params);
+	}
+
+	DataType xData;
+	DataType yData;
+	const double* weights; //optional, see GaussFunctor
+
+private:
+	double weight(int i) const { return this->weights != nullptr ? this->weights[i] : 1.0; }
+};
+
+/***********************************************************************************************/
+
+// Functor for the sum of several peaks of one PSF model with a common offset k
+// Parameters: k, then for every peak all model parameters except k (a is the peak height above k). The number of peaks is only known at runtime,
+// the model of a single peak is still evaluated by the fixed-size specialization
+template<typename Model>
+struct PsfMultiPeakFunctor : Functor<double>
+{
+	typedef Functor<double>::InputType InputType;
+	typedef Eigen::Map<const Eigen::VectorXd> DataType;
+	typedef Eigen::MatrixXd NormalMatrixType;
+	typedef typename Model::Params PeakParams;
+	enum { PeakParameterCount = Model::ParameterCount - 1 };
+
+	PsfMultiPeakFunctor(const double* xData, const double* yData, int values, int peaks)
+		: Functor<double>(1 + peaks * PeakParameterCount, values), xData(xData, values), yData(yData, values), peaks(peaks) {}
+
+	// Model parameters of one peak with k = 0
+	static void peakParams(const InputType &params, int peak, PeakParams &peakParams) {
+		int offset = 1 + peak * PeakParameterCount;
+		peakParams[0] = params[offset];
+		peakParams[1] = 0.0;
+		for (int i = 2; i < Model::ParameterCount; ++i) {
+			peakParams[i] = params[offset + i - 1];
+		}
+	}
+
+	double value(const InputType &params, double x) const {
+		double sum = params[0];
+		PeakParams peak;
+		for (int j = 0; j < this->peaks; ++j) {
+			peakParams(params, j, peak);
+			sum += Model::value(peak, x);
+		}
+		return sum;
+	}
+
+	// Sum of squared residuals
+	double cost(const InputType &params) const {
+		double sum = 0.0;
+		for (int i = 0; i < xData.size(); ++i) {
+			double residual = yData[i] - this->value(params, xData[i]);
+			sum += residual * residual;
+		}
+		return sum;
+	}
+
+	// Same as PsfModelFunctor::normalEquations(..), the gradients of the single peaks are scattered into one Jacobian row
+	double normalEquations(const InputType &params, NormalMatrixType &jtj, InputType &jtr) const {
+		int parameterCount = static_cast<int>(params.size());
+		jtj.setZero(parameterCount, parameterCount);
+		jtr.setZero(parameterCount);
+		double sum = 0.0;
+		InputType row(parameterCount);
+		PeakParams peak;
+		PeakParams gradient;
+		for (int i = 0; i < xData.size(); ++i) {
+			double value = params[0];
+			row[0] = 1.0;
+			for (int j = 0; j < this->peaks; ++j) {
+				peakParams(params, j, peak);
+				value += Model::valueAndGradient(peak, xData[i], gradient);
+				int offset = 1 + j * PeakParameterCount;
+				row[offset] = gradient[0];
+				for (int k = 2; k < Model::ParameterCount; ++k) {
+					row[offset + k - 1] = gradient[k];
+				}
+			}
+			double residual = yData[i] - value;
+			jtj.noalias() += row * row.transpose();
+			jtr -= row * residual;
+			sum += residual * residual;
+		}
+		return sum;
+	}
+
+	void constrain(InputType &params) const {
+		PeakParams peak;
+		for (int j = 0; j < this->peaks; ++j) {
+			peakParams(params, j, peak);
+			Model::constrain(peak);
+			int offset = 1 + j * PeakParameterCount;
+			params[offset] = peak[0];
+			for (int i = 2; i < Model::ParameterCount; ++i) {
+				params[offset + i - 1] = peak[i];
+			}
+		}
 	}
 
-	const Eigen::VectorXd xData;
-	const Eigen::VectorXd yData;
+	DataType xData;
+	DataType yData;
+	int peaks;
 };
 
 #endif //OPTIMIZATIONFUNCTOR_H
@@ -0,0 +1,125 @@
+#include "peakfinder.h"
+#include <algorithm>
+
+
+QVector<PeakFinder::Peak> PeakFinder::findPeaks(const double* x, const double* y, int size, double minRelativeProminence, int maxPeaks) {
+	QVector<Peak> peaks;
+	if (size < 3 || maxPeaks < 1) {
+		return peaks;
+	}
+	double yMin = y[0];
+	double yMax = y[0];
+	for (int i = 1; i < size; i++) {
+		yMin = qMin(yMin, y[i]);
+		yMax = qMax(yMax, y[i]);
+	}
+	if (!(yMax > yMin)) {
+		return peaks;
+	}
+	double minProminence = minRelativeProminence * (yMax - yMin);
+
+	//index of the minimum between each sample and the next higher sample to the left and to the right
+	QVector<int> leftBases(size);
+	QVector<int> rightBases(size);
+	findBases(y, size, false, leftBases);
+	findBases(y, size, true, rightBases);
+
+	//local maxima (plateaus count once, at their first sample) with sufficient prominence
+	for (int i = 1; i < size-1; i++) {
+		if (!(y[i] > y[i-1] && y[i] >= y[i+1])) {
+			continue;
+		}
+		double prominence = y[i] - qMax(y[leftBases[i]], y[rightBases[i]]);
+		if (prominence < minProminence || !(prominence > 0.0)) {
+			continue;
+		}
+		Peak peak;
+		peak.index = i;
+		peak.value = y[i];
+		peak.prominence = prominence;
+		peak.leftBound = leftBases[i];
+		peak.rightBound = rightBases[i];
+		double denominator = y[i-1] - 2.0 * y[i] + y[i+1];
+		double offset = denominator < 0.0 ? 0.5 * (y[i-1] - y[i+1]) / denominator : 0.0;
+		peak.position = x[i] + offset * (x[i+1] - x[i]);
+		peaks.append(peak);
+	}
+
+	//keep the most prominent peaks, sorted by position
+	if (peaks.size() > maxPeaks) {
+		std::sort(peaks.begin(), peaks.end(), [](const Peak& a, const Peak& b) { return a.prominence > b.prominence; });
+		peaks.resize(maxPeaks);
+	}
+	std::sort(peaks.begin(), peaks.end(), [](const Peak& a, const Peak& b) { return a.index < b.index; });
+
+	//neighbouring detected peaks are separated at the valley between them
+	for (int i = 0; i < peaks.size(); i++) {
+		if (i > 0) {
+			peaks[i].leftBound = qMax(peaks[i].leftBound, findValley(y, peaks[i-1].index, peaks[i].index));
+		}
+		if (i < peaks.size()-1) {
+			int valley = findValley(y, peaks[i].index, peaks[i+1].index);
+			peaks[i].rightBound = qMin(peaks[i].rightBound, valley);
+			//half maximum of the lower peak above the minimum of the data. the prominence of the lower peak is measured from this valley, so it can not be used here
+			double halfMaximum = yMin + 0.5 * (qMin(peaks[i].value, peaks[i+1].value) - yMin);
+			peaks[i].overlapsNext = y[valley] > halfMaximum;
+		} else {
+			peaks[i].overlapsNext = false;
+		}
+	}
+	for (int i = 0; i < peaks.size(); i++) {
+		double level = peaks[i].value - 0.5 * peaks[i].prominence;
+		peaks[i].leftCrossing = findCrossing(x, y, peaks[i].index, peaks[i].leftBound, level);
+		peaks[i].rightCrossing = findCrossing(x, y, peaks[i].index, peaks[i].rightBound, level);
+	}
+	return peaks;
+}
+
+void PeakFinder::findBases(const double* y, int size, bool reverse, QVector<int>& bases) {
+	//the stack holds samples with decreasing values, each together with the index of the minimum between it and the previous stack entry.
+	//samples that are not higher than the current one are popped and their minima are merged, so every sample is pushed and popped once
+	struct StackEntry {
+		int index;
+		int minIndex;
+	};
+	QVector<StackEntry> stack;
+	stack.reserve(size);
+	for (int n = 0; n < size; n++) {
+		int i = reverse ? size-1-n : n;
+		int minIndex = i;
+		while (!stack.isEmpty() && y[stack.last().index] <= y[i]) {
+			if (y[stack.last().minIndex] < y[minIndex]) {
+				minIndex = stack.last().minIndex;
+			}
+			stack.removeLast();
+		}
+		bases[i] = minIndex;
+		StackEntry entry;
+		entry.index = i;
+		entry.minIndex = minIndex;
+		stack.append(entry);
+	}
+}
+
+int PeakFinder::findValley(const double* y, int from, int to) {
+	int valley = from;
+	for (int i = from+1; i <= to; i++) {
+		if (y[i] < y[valley]) {
+			valley = i;
+		}
+	}
+	return valley;
+}
+
+double PeakFinder::findCrossing(const double* x, const double* y, int peak, int bound, double level) {
+	int step = bound < peak ? -1 : 1;
+	int i = peak;
+	while (i != bound && y[i+step] > level) {
+		i += step;
+	}
+	if (i == bound) {
+		return x[bound];
+	}
+	double fraction = (y[i] - level) / (y[i] - y[i+step]);
+	return x[i] + fraction * (x[i+step] - x[i]);
+}
@@ -0,0 +1,37 @@
+#ifndef PEAKFINDER_H
+#define PEAKFINDER_H
+
+#include <QtGlobal>
+#include <QVector>
+
+#define PEAK_FINDER_MAX_PEAKS 16
+#define PEAK_FINDER_DEFAULT_MIN_PROMINENCE 0.1 //relative to max-min of the data
+
+
+//prominence based peak detection. the prominence of a local maximum is its height above the higher of the two minima between the peak and the next higher sample on each side
+//(or the data edge). both minima are found with a monotonic stack in one pass per direction, so the detection runs in O(n).
+class PeakFinder
+{
+public:
+	struct Peak {
+		int index; //sample with the local maximum
+		double position; //sub-sample position of the maximum (parabola through the three highest samples)
+		double value;
+		double prominence;
+		int leftBound; //minimum between this peak and the next detected peak (or the next higher peak) on each side. fits of this peak should not use data outside of the bounds
+		int rightBound;
+		double leftCrossing; //x at half prominence, linear interpolation. the walk stops at the bounds
+		double rightCrossing;
+		bool overlapsNext; //valley to the next detected peak does not drop below half maximum of the lower of the two peaks: both peaks need to be fitted together
+	};
+
+	//peaks with a prominence of at least minRelativeProminence*(max-min), at most maxPeaks (the most prominent ones). result is sorted by position
+	static QVector<Peak> findPeaks(const double* x, const double* y, int size, double minRelativeProminence, int maxPeaks);
+
+private:
+	static void findBases(const double* y, int size, bool reverse, QVector<int>& bases);
+	static int findValley(const double* y, int from, int to);
+	static double findCrossing(const double* x, const double* y, int peak, int bound, double level);
+};
+
+#endif //PEAKFINDER_H
@@ -1,53 +1,275 @@
 #include "peakfit.h"
 #include <QtMath>
-#include "gaussfit.h"
+#include "columnsum.h"
+#include "halfmaximumwidth.h"
+#include "psfmodelregistry.h"
+#include "peakfinder.h"
+#include <QtConcurrent>
+#include <QTimer>
 
 PeakFit::PeakFit(QObject *parent)
 	: QObject(parent),
-	isPeakFitting(false)
+	isPeakFitting(false),
+	warmStartValid(false),
+	lastRelativeRms(0.0),
+	fitCount(0),
+	budgetExceededCount(0),
+	modelName(PSF_MODEL_DEFAULT),
+	modelFit(nullptr),
+	lastFrame(nullptr),
+	lastAveragedLineValid(false),
+	reanalysisPending(false),
+	generation(1),
+	analyzedGeneration(0),
+	unchangedFrameCount(0),
+	requestedParamsValid(false)
 {
 
 }
 
+PeakFit::~PeakFit() {
+	this->retainFrame(nullptr);
+	delete this->modelFit;
+	qDeleteAll(this->multiPeakFits);
+}
+
 void PeakFit::setParams(AxialPsfAnalyzerParameters params) {
+	//a different roi, fit mode, model or number of peaks makes the previous fit result useless as starting point
+	if (params.roi != this->params.roi || params.fitModeLogarithmEnabled != this->params.fitModeLogarithmEnabled || params.psfModel != this->params.psfModel || params.maxPeakCount != this->params.maxPeakCount) {
+		this->warmStartValid = false;
+	}
+	if (params.psfModel != this->params.psfModel) {
+		this->setModel(params.psfModel);
+	}
+	//frames of a different roi, projection, frame or buffer must not be averaged with the new ones
+	if (params.roi != this->params.roi || params.lineProjection != this->params.lineProjection || params.projectionTrimFraction != this->params.projectionTrimFraction || params.frameNr != this->params.frameNr || params.bufferNr != this->params.bufferNr || params.bufferSource != this->params.bufferSource) {
+		this->temporalAverage.reset();
+	}
+	this->temporalAverage.setFrameCount(params.temporalAverageFrames);
+	//a different roi or projection changes the averaged line of the last frame, all other parameters only change how it is fitted
+	if (params.roi != this->params.roi || params.lineProjection != this->params.lineProjection || params.projectionTrimFraction != this->params.projectionTrimFraction || params.temporalAverageFrames != this->params.temporalAverageFrames) {
+		this->lastAveragedLineValid = false;
+	}
+	bool reanalysisNeeded = changesAnalysis(this->params, params);
 	this->params = params;
+	if (reanalysisNeeded) {
+		this->requestReanalysis();
+	}
 }
 
-void PeakFit::fitPeak(void* frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame) {
-	if (!this->isPeakFitting) {
-		this->isPeakFitting = true;
+bool PeakFit::changesAnalysis(const AxialPsfAnalyzerParameters& previous, const AxialPsfAnalyzerParameters& current) {
+	//window state, display and acquisition settings do not change the result of the last frame
+	return current.roi != previous.roi
+		|| current.psfModel != previous.psfModel
+		|| current.maxPeakCount != previous.maxPeakCount
+		|| current.peakMinProminence != previous.peakMinProminence
+		|| current.fitModeLogarithmEnabled != previous.fitModeLogarithmEnabled
+		|| current.logFitRefinementEnabled != previous.logFitRefinementEnabled
+		|| current.fwhmEstimator != previous.fwhmEstimator
+		|| current.halfMaxInterpolation != previous.halfMaxInterpolation
+		|| current.fitEstimateAcceptanceThreshold != previous.fitEstimateAcceptanceThreshold
+		|| current.fitWarmStartEnabled != previous.fitWarmStartEnabled
+		|| current.fitTimeBudgetUs != previous.fitTimeBudgetUs
+		|| current.fitWindowEnabled != previous.fitWindowEnabled
+		|| current.fitWindowSigmaFactor != previous.fitWindowSigmaFactor
+		|| current.lateralProfileEnabled != previous.lateralProfileEnabled
+		|| current.temporalAverageFrames != previous.temporalAverageFrames
+		|| current.upsamplingFactor != previous.upsamplingFactor
+		|| current.robustLoss != previous.robustLoss
+		|| current.lineProjection != previous.lineProjection
+		|| current.projectionTrimFraction != previous.projectionTrimFraction;
+}
 
-		//average all A-scans within roi
-		QVector<qreal> averagedLine = this->calculateAveragedLine(frameBuffer, bitDepth, samplesPerLine, linesPerFrame);
+void PeakFit::invalidate(AxialPsfAnalyzerParameters params) {
+	//called in the thread of the sender, before the parameters reach setParams(..) through the event loop of the fit thread.
+	//the changed generation makes a running analysis with the previous parameters stop before its results are emitted
+	QMutexLocker locker(&this->requestedParamsMutex);
+	if (!this->requestedParamsValid || changesAnalysis(this->requestedParams, params)) {
+		this->generation.fetchAndAddOrdered(1);
+	}
+	this->requestedParams = params;
+	this->requestedParamsValid = true;
+}
 
-		//clamp averaged line to only use values within roi for fit
-		int startIndex = this->params.roi.normalized().x();
-		int endIndex = startIndex + this->params.roi.normalized().width()-1;
-		QPair<QVector<qreal>, QVector<qreal>> result = this->clampLine(averagedLine, startIndex, endIndex);
-		QVector<qreal> xValuesAveragedLine = result.first;
-		QVector<qreal> yValuesAveragedLine = result.second;
-		int samplesInClampedLine = xValuesAveragedLine.size();
-		emit averagedLineCalculated(xValuesAveragedLine, yValuesAveragedLine);
+void PeakFit::setModel(const QString& name) {
+	//the Gaussian has its own fit with logarithmic mode and closed-form estimator, all other models are fitted with the PsfModelFit specialization from the registry
+	QString registeredName = name;
+	if (!PsfModelRegistry::instance().contains(registeredName)) {
+		emit error(tr("Unknown PSF model: ") + name + tr(". Gaussian is used instead."));
+		registeredName = PSF_MODEL_DEFAULT;
+	}
+	if (registeredName == this->modelName) {
+		return;
+	}
+	this->modelName = registeredName;
+	this->lateralProfileFit.setModel(this->modelName);
+	qDeleteAll(this->multiPeakFits);
+	this->multiPeakFits.clear();
+	delete this->modelFit;
+	this->modelFit = nullptr;
+	if (this->modelName != GaussianModel::name()) {
+		this->modelFit = PsfModelRegistry::instance().create(this->modelName);
+	}
+}
 
-		//convert QVector to Eigen::VectorXd for GaussFit
-		Eigen::VectorXd xData(samplesInClampedLine);
-		Eigen::VectorXd yData(samplesInClampedLine);
+void PeakFit::fitPeak(FrameSlot* frame) {
+	//frame may be skipped if a newer frame is already waiting (depends on drop policy of frame ring)
+	if (this->isPeakFitting || !frame->acquire()) {
+		frame->release();
+		return;
+	}
 
-		for (int i = 0; i < samplesInClampedLine; i++) {
-			xData[i] = xValuesAveragedLine[i]; // x values are the indices
-			yData[i] = yValuesAveragedLine[i]; // y values are the data points
+	//a frame that is fetched again without any change within the roi (paused acquisition, frozen display) gives the same result. if the parameters did not change
+	//since the last frame was analyzed, the previous result is emitted again instead of averaging and fitting the same data. the last frame is kept, it has the same content.
+	//the content type is compared as well: column sums and frame data of the same roi have the same fingerprint, but only frame data can be analyzed again with another roi
+	if (this->lastFrame != nullptr && frame->fingerprint != ROI_FINGERPRINT_NONE && frame->fingerprint == this->lastFrame->fingerprint && frame->content == this->lastFrame->content
+		&& this->analyzedGeneration == this->generation.loadAcquire()) {
+		frame->release();
+		this->unchangedFrameCount++;
+		if (this->unchangedFrameCount == 1 || this->unchangedFrameCount % 100 == 0) {
+			emit info(tr("Unchanged frame within roi, previous fit result is used (%1 times)").arg(this->unchangedFrameCount));
 		}
+		this->emitFitResult(this->lastFitResult);
+		return;
+	}
 
-		//perform Gauss fit on the data
-		GaussFit gaussFit(xData, yData);
-		int maxPos = this->findMaxValuePosition(averagedLine);
-		double maxValue = averagedLine.at(qAbs(maxPos));
-		gaussFit.setInitialGuessForM(maxPos);
-		gaussFit.setInitialGuessForA(maxValue);
-		gaussFit.fit();
+	//the frame slot is kept instead of released until the next frame arrives, so the frame can be analyzed again if roi or parameters change
+	this->retainFrame(frame);
+	this->analyzeLastFrame();
+}
+
+void PeakFit::reanalyze() {
+	//all changes that were queued before this call are handled at once with the newest roi and parameters
+	this->reanalysisPending = false;
+	FrameSlot* frame = this->lastFrame;
+	if (this->isPeakFitting || frame == nullptr || this->analyzedGeneration == this->generation.loadAcquire()) {
+		return;
+	}
+	//column sums of the fused ingest only contain the roi at the time of ingest
+	if (!this->lastAveragedLineValid && frame->content != FRAME_DATA) {
+		return;
+	}
+
+	//the summed-area table costs one pass over the frame, every further roi of the same frame is averaged in O(roi width)
+	if (!this->lastAveragedLineValid && !this->prefixSum.isValid() && this->params.lineProjection == MEAN_PROJECTION) {
+		qint64 samples = static_cast<qint64>(frame->samplesPerLine)*frame->linesPerFrame;
+		if (this->params.parallelReductionThreshold > 0 && samples >= this->params.parallelReductionThreshold) {
+			this->prefixSum.buildParallel(frame->data, frame->pixelType, frame->samplesPerLine, frame->samplesPerLine, frame->linesPerFrame);
+		} else {
+			this->prefixSum.build(frame->data, frame->pixelType, frame->samplesPerLine, frame->samplesPerLine, frame->linesPerFrame);
+		}
+	}
+	this->analyzeLastFrame();
+}
+
+void PeakFit::analyzeLastFrame() {
+	this->isPeakFitting = true;
+	quint64 generation = this->generation.loadAcquire();
+	FrameSlot* frame = this->lastFrame;
+
+	//average all A-scans within roi. the averaged line is kept, so a change of fit parameters only repeats the fit
+	if (!this->lastAveragedLineValid) {
+		this->lastAveragedLine = this->calculateAveragedLine(frame);
+		if (this->params.temporalAverageFrames > 1) {
+			this->averageOverFrames(this->lastAveragedLine);
+		}
+		this->lastAveragedLineValid = true;
+	}
+	if (this->params.lateralProfileEnabled && !this->isStale(generation)) {
+		this->fitLateralProfile(frame);
+	}
+
+	//results of an analysis whose roi or parameters have been changed meanwhile are not emitted. the analysis is repeated with the newest parameters
+	if (!this->isStale(generation)) {
+		this->fitAveragedLine(this->lastAveragedLine);
+		this->analyzedGeneration = generation;
+	}
+	this->isPeakFitting = false;
+}
+
+bool PeakFit::isStale(quint64 generation) const {
+	return this->generation.loadAcquire() != generation;
+}
+
+void PeakFit::requestReanalysis() {
+	//the last frame is analyzed again with the new roi or parameters, so results follow the settings (e.g. while the roi is dragged) even if acquisition is stopped.
+	//the reanalysis is queued behind the changes that are already waiting, only one reanalysis is pending at a time
+	this->generation.fetchAndAddOrdered(1);
+	if (this->lastFrame != nullptr && !this->reanalysisPending) {
+		this->reanalysisPending = true;
+		QTimer::singleShot(0, this, &PeakFit::reanalyze);
+	}
+}
+
+void PeakFit::retainFrame(FrameSlot* frame) {
+	if (this->lastFrame != nullptr) {
+		this->lastFrame->release();
+	}
+	this->lastFrame = frame;
+	this->prefixSum.clear();
+	this->lastAveragedLineValid = false;
+}
+
+void PeakFit::fitAveragedLine(const QVector<qreal>& averagedLine) {
+	//clamp averaged line to only use values within roi for fit
+	int startIndex = this->params.roi.normalized().x();
+	int endIndex = startIndex + this->params.roi.normalized().width()-1;
+	QPair<QVector<qreal>, QVector<qreal>> result = this->clampLine(averagedLine, startIndex, endIndex);
+	QVector<qreal> xValuesAveragedLine = result.first;
+	QVector<qreal> yValuesAveragedLine = result.second;
+	int samplesInClampedLine = xValuesAveragedLine.size();
+	emit averagedLineCalculated(xValuesAveragedLine, yValuesAveragedLine);
+
+	//optional band-limited upsampling of the roi window: estimators and fits get several samples across PSFs that are only a few pixels wide
+	bool upsampled = this->params.upsamplingFactor > 1 && this->upsampler.upsample(xValuesAveragedLine.constData(), yValuesAveragedLine.constData(), samplesInClampedLine, this->params.upsamplingFactor, this->upsampledX, this->upsampledY);
+	const QVector<qreal>& xValues = upsampled ? this->upsampledX : xValuesAveragedLine;
+	const QVector<qreal>& yValues = upsampled ? this->upsampledY : yValuesAveragedLine;
+
+	QElapsedTimer fitTimer;
+	fitTimer.start();
+	FitResult fitResult;
+	fitResult.valid = false;
+	fitResult.peakPosition = qQNaN();
+	fitResult.fwhm = -1.0;
+	fitResult.evaluations = 0;
+	fitResult.budgetExceeded = false;
+	fitResult.halfMaxPeakPosition = qQNaN();
+	fitResult.halfMaxFwhm = -1.0;
+
+	//non-parametric fwhm directly on the averaged line, no fit
+	HalfMaximumWidth::Result halfMax;
+	if (this->params.fwhmEstimator != GAUSS_FIT_FWHM) {
+		halfMax = HalfMaximumWidth::calculate(xValues.constData(), yValues.constData(), xValues.size(), this->params.halfMaxInterpolation);
+		fitResult.halfMaxPeakPosition = halfMax.peakPosition;
+		fitResult.halfMaxFwhm = halfMax.valid ? halfMax.fwhm : -1.0;
+	}
 
-		//get the fitted Gaussian function
-		GaussFunction fittedGauss = gaussFit.getGaussianFunction();
+	if (this->params.fwhmEstimator == HALF_MAXIMUM_FWHM) {
+		fitResult.valid = halfMax.valid;
+		fitResult.peakPosition = fitResult.halfMaxPeakPosition;
+		fitResult.fwhm = fitResult.halfMaxFwhm;
+
+		//half maximum level between the two crossings is plotted instead of a fitted curve
+		if (halfMax.valid) {
+			double halfMaxLevel = halfMax.baseline + 0.5 * (halfMax.peakValue - halfMax.baseline);
+			emit fitCalculated(QVector<qreal>{halfMax.leftCrossing, halfMax.rightCrossing}, QVector<qreal>{halfMaxLevel, halfMaxLevel});
+		}
+	} else if (this->params.maxPeakCount > 1) {
+		QVector<qreal> fitX;
+		QVector<qreal> fitY;
+		this->fitMultiplePeaks(xValues, yValues, fitResult, fitX, fitY);
+		emit fitCalculated(fitX, fitY);
+	} else {
+		QVector<qreal> xValuesFitWindow = xValues;
+		QVector<qreal> yValuesFitWindow = yValues;
+		if (this->params.fitWindowEnabled) {
+			this->cropToFitWindow(xValuesFitWindow, yValuesFitWindow);
+		}
+		if (this->modelFit == nullptr) {
+			this->fitGauss(averagedLine, xValuesFitWindow, yValuesFitWindow, fitResult);
+		} else {
+			this->fitModel(xValuesFitWindow, yValuesFitWindow, fitResult);
+		}
 
 		//generate fitted curve data for plot
 		QVector<qreal> fitX;
@@ -58,24 +280,348 @@ void PeakFit::fitPeak(void* frameBuffer, unsigned int bitDepth, unsigned int sam
 		double step = static_cast<double>(samplesInClampedLine)/static_cast<double>(fitLength);
 		for (int i = 0; i < fitLength; i++) {
 			fitX[i] = xValuesAveragedLine.at(0)+ step*i;
-			fitY[i] = fittedGauss(fitX.at(i));
+		}
+		if (this->modelFit == nullptr) {
+			GaussFunction fittedGauss = this->gaussFit.getGaussianFunction();
+			for (int i = 0; i < fitLength; i++) {
+				fitY[i] = fittedGauss(fitX.at(i));
+			}
+		} else {
+			this->modelFit->evaluate(fitX.constData(), fitY.data(), fitLength);
 		}
 		emit fitCalculated(fitX, fitY);
+	}
+
+	//fit result with time budget metrics
+	this->fitCount++;
+	if (fitResult.budgetExceeded) {
+		this->budgetExceededCount++;
+		if (this->budgetExceededCount == 1 || this->budgetExceededCount % 100 == 0) {
+			emit info(tr("Fit time budget exceeded in %1 of %2 fits (%3 %)").arg(this->budgetExceededCount).arg(this->fitCount).arg(100.0*this->budgetExceededCount/this->fitCount, 0, 'f', 1));
+		}
+	}
+	fitResult.fitTimeUs = fitTimer.nsecsElapsed()/1000;
+	fitResult.fitCount = this->fitCount;
+	fitResult.budgetExceededCount = this->budgetExceededCount;
+
+	//fit quality is logged for every single fetch and periodically during auto fetching
+	if (fitResult.quality.valid && (!this->params.autoFetchingEnabled || this->fitCount % PEAKFIT_QUALITY_LOG_INTERVAL == 1)) {
+		const FitQuality& quality = fitResult.quality;
+		emit info(tr("Fit quality: R² = %1, reduced chi² = %2, residual rms = %3, peak position = %4 ± %5 px, FWHM = %6 ± %7 px")
+			.arg(quality.rSquared, 0, 'f', 4).arg(quality.reducedChiSquared, 0, 'g', 4).arg(quality.residualRms, 0, 'g', 4)
+			.arg(fitResult.peakPosition, 0, 'f', 2).arg(quality.peakPositionSigma, 0, 'f', 3)
+			.arg(fitResult.fwhm, 0, 'f', 2).arg(quality.fwhmSigma, 0, 'f', 3));
+	}
+
+	this->emitFitResult(fitResult);
+}
+
+void PeakFit::emitFitResult(const FitResult& fitResult) {
+	//result is kept, so it can be emitted again for an unchanged frame
+	this->lastFitResult = fitResult;
+
+	//emit fwhm and peak position
+	emit fwhmCalculated(fitResult.fwhm);
+	emit peakPositionFound(fitResult.peakPosition);
+	if (this->params.fwhmEstimator == GAUSS_FIT_AND_HALF_MAXIMUM_FWHM) {
+		emit halfMaxFwhmCalculated(fitResult.halfMaxFwhm);
+	}
+
+	emit fitResultCalculated(fitResult);
+}
+
+void PeakFit::fitGauss(const QVector<qreal>& averagedLine, const QVector<qreal>& xValues, const QVector<qreal>& yValues, FitResult& fitResult) {
+	//perform Gauss fit on the data. the fit object is reused for every frame, so its workspace is only allocated once
+	this->gaussFit.setData(xValues.constData(), yValues.constData(), xValues.size());
+	this->gaussFit.setEstimateAcceptanceThreshold(this->params.fitEstimateAcceptanceThreshold);
+	this->gaussFit.setRobustLoss(this->params.robustLoss);
+	QElapsedTimer fitTimer;
+	fitTimer.start();
+	int evaluations = 0;
+	bool budgetExceeded = false;
+
+	if (this->params.fitModeLogarithmEnabled) {
+		//logarithmic mode: non-iterative parabola fit in log space. LM is only used to refine the result (if enabled) or if the parabola fit fails
+		bool logFitSucceeded = this->gaussFit.fitLogarithmic();
+		evaluations += this->gaussFit.getEvaluations();
+		if (!logFitSucceeded || this->params.logFitRefinementEnabled) {
+			if (!logFitSucceeded) {
+				this->setColdStartGuess(averagedLine);
+			}
+			this->gaussFit.setTimeBudget(this->params.fitTimeBudgetUs);
+			this->gaussFit.fit();
+			evaluations += this->gaussFit.getEvaluations();
+			budgetExceeded = this->gaussFit.isBudgetExceeded();
+		}
+	} else {
+		//warm start from the previous result, successive frames of the same reflection barely change. offset k and width s are taken from the previous fit,
+		//peak height a and position m from the closed-form estimate of the current frame, because they follow the (slowly moving) peak.
+		//if the residual jumps the peak has changed (or the fit ran into a wrong minimum) and the fit is repeated with a cold start
+		bool warmStartSucceeded = false;
+		if (this->params.fitWarmStartEnabled && this->warmStartValid) {
+			GaussParams initialGuess = this->lastFitParams;
+			if (this->gaussFit.estimateInitialGuess()) {
+				initialGuess[0] = this->gaussFit.getParams()[0];
+				initialGuess[2] = this->gaussFit.getParams()[2];
+			}
+			this->gaussFit.setInitialGuess(initialGuess);
+			this->gaussFit.setTimeBudget(this->params.fitTimeBudgetUs);
+			this->gaussFit.fit();
+			evaluations += this->gaussFit.getEvaluations();
+			budgetExceeded = this->gaussFit.isBudgetExceeded();
+			//no time left for a cold start: the warm started result is used anyway (and flagged)
+			warmStartSucceeded = budgetExceeded || (this->gaussFit.isValid() && this->gaussFit.getRelativeRms() <= this->lastRelativeRms * PEAKFIT_WARM_START_MAX_RESIDUAL_INCREASE);
+		}
+		if (!warmStartSucceeded) {
+			this->setColdStartGuess(averagedLine);
+			//time budget is shared with the warm started fit
+			int remainingBudgetUs = this->params.fitTimeBudgetUs - static_cast<int>(fitTimer.nsecsElapsed()/1000);
+			this->gaussFit.setTimeBudget(this->params.fitTimeBudgetUs > 0 ? qMax(1, remainingBudgetUs) : 0);
+			this->gaussFit.fit();
+			evaluations += this->gaussFit.getEvaluations();
+			budgetExceeded = this->gaussFit.isBudgetExceeded();
+		}
+	}
+	this->warmStartValid = this->gaussFit.isValid();
+	if (this->warmStartValid) {
+		this->lastFitParams = this->gaussFit.getParams();
+		this->lastRelativeRms = this->gaussFit.getRelativeRms();
+	}
+
+	GaussFunction fittedGauss = this->gaussFit.getGaussianFunction();
+	fitResult.valid = this->gaussFit.isValid();
+	fitResult.peakPosition = fittedGauss.getM();
+	fitResult.fwhm = fittedGauss.getFWHM();
+	fitResult.evaluations = evaluations;
+	fitResult.budgetExceeded = budgetExceeded;
+	fitResult.quality = this->gaussFit.getQuality();
+}
+
+void PeakFit::fitModel(const QVector<qreal>& xValues, const QVector<qreal>& yValues, FitResult& fitResult) {
+	this->modelFit->setData(xValues.constData(), yValues.constData(), xValues.size());
+	this->modelFit->setRobustLoss(this->params.robustLoss);
+	QElapsedTimer fitTimer;
+	fitTimer.start();
+	int evaluations = 0;
+	bool budgetExceeded = false;
+
+	//warm start as for the Gauss fit: offset and shape parameters of the previous fit, peak value and position of the current frame
+	bool warmStartSucceeded = false;
+	if (this->params.fitWarmStartEnabled && this->warmStartValid && this->modelFit->estimateInitialGuess(true)) {
+		this->modelFit->setTimeBudget(this->params.fitTimeBudgetUs);
+		this->modelFit->fit();
+		evaluations += this->modelFit->getEvaluations();
+		budgetExceeded = this->modelFit->isBudgetExceeded();
+		warmStartSucceeded = budgetExceeded || (this->modelFit->isValid() && this->modelFit->getRelativeRms() <= this->lastRelativeRms * PEAKFIT_WARM_START_MAX_RESIDUAL_INCREASE);
+	}
+	if (!warmStartSucceeded && this->modelFit->estimateInitialGuess(false)) {
+		int remainingBudgetUs = this->params.fitTimeBudgetUs - static_cast<int>(fitTimer.nsecsElapsed()/1000);
+		this->modelFit->setTimeBudget(this->params.fitTimeBudgetUs > 0 ? qMax(1, remainingBudgetUs) : 0);
+		this->modelFit->fit();
+		evaluations += this->modelFit->getEvaluations();
+		budgetExceeded = this->modelFit->isBudgetExceeded();
+	}
+	this->warmStartValid = this->modelFit->isValid();
+	if (this->warmStartValid) {
+		this->lastRelativeRms = this->modelFit->getRelativeRms();
+	}
+
+	fitResult.valid = this->modelFit->isValid();
+	fitResult.peakPosition = this->modelFit->getPeakPosition();
+	fitResult.fwhm = this->modelFit->getFWHM();
+	fitResult.evaluations = evaluations;
+	fitResult.budgetExceeded = budgetExceeded;
+	fitResult.quality = this->modelFit->getQuality();
+}
+
+void PeakFit::fitMultiplePeaks(const QVector<qreal>& xValues, const QVector<qreal>& yValues, FitResult& fitResult, QVector<qreal>& fitX, QVector<qreal>& fitY) {
+	//peaks that overlap are fitted together, every group of peaks only in the window between its neighbours
+	QVector<PeakFinder::Peak> peaks = PeakFinder::findPeaks(xValues.constData(), yValues.constData(), xValues.size(), this->params.peakMinProminence, qBound(1, this->params.maxPeakCount, PEAK_FINDER_MAX_PEAKS));
+	struct PeakGroup {
+		int firstPeak;
+		int peakCount;
+		int left;
+		int right;
+		AbstractPsfMultiPeakFit* fit;
+	};
+	QVector<PeakGroup> groups;
+	for (int i = 0; i < peaks.size(); ) {
+		PeakGroup group;
+		group.firstPeak = i;
+		while (i < peaks.size()-1 && peaks.at(i).overlapsNext) {
+			i++;
+		}
+		group.peakCount = i - group.firstPeak + 1;
+		group.left = peaks.at(group.firstPeak).leftBound;
+		group.right = peaks.at(i).rightBound;
+		groups.append(group);
+		i++;
+	}
+
+	//fit objects are kept for the next frame, so their buffers are only allocated once
+	while (this->multiPeakFits.size() < groups.size()) {
+		this->multiPeakFits.append(PsfModelRegistry::instance().createMultiPeak(this->modelName));
+	}
+	for (int i = 0; i < groups.size(); i++) {
+		PeakGroup& group = groups[i];
+		group.fit = this->multiPeakFits.at(i);
+		group.fit->setData(xValues.constData() + group.left, yValues.constData() + group.left, group.right - group.left + 1);
+		group.fit->setInitialGuess(peaks.constData() + group.firstPeak, group.peakCount);
+		group.fit->setTimeBudget(this->params.fitTimeBudgetUs);
+	}
 
-		//calculate and emit fwhm
-		double fwhm = fittedGauss.getFWHM();
-		emit fwhmCalculated(fwhm);
+	//groups are independent of each other and are fitted in parallel
+	if (groups.size() > 1) {
+		QtConcurrent::blockingMap(groups, [](PeakGroup& group) {
+			group.fit->fit();
+		});
+	} else if (groups.size() == 1) {
+		groups[0].fit->fit();
+	}
 
-		//emit peak position
-		double peakPosition = fittedGauss.getM();
-		emit peakPositionFound(peakPosition);
+	//results of all peaks. fwhm and peak position of the fit result are taken from the most prominent peak
+	QVector<qreal> positions;
+	QVector<qreal> fwhms;
+	int mainPeak = -1;
+	int mainGroup = -1;
+	int evaluations = 0;
+	bool budgetExceeded = false;
+	bool valid = !groups.isEmpty();
+	for (int i = 0; i < groups.size(); i++) {
+		const PeakGroup& group = groups.at(i);
+		evaluations += group.fit->getEvaluations();
+		budgetExceeded = budgetExceeded || group.fit->isBudgetExceeded();
+		valid = valid && group.fit->isValid();
+		for (int j = 0; j < group.peakCount; j++) {
+			int peak = group.firstPeak + j;
+			positions.append(group.fit->getPeakPosition(j));
+			fwhms.append(group.fit->getFWHM(j));
+			if (mainPeak < 0 || peaks.at(peak).prominence > peaks.at(mainPeak).prominence) {
+				mainPeak = peak;
+				mainGroup = i;
+			}
+		}
+	}
+	fitResult.valid = valid;
+	fitResult.peakPosition = mainPeak >= 0 ? positions.at(mainPeak) : qQNaN();
+	fitResult.fwhm = mainPeak >= 0 ? fwhms.at(mainPeak) : -1.0;
+	fitResult.evaluations = evaluations;
+	fitResult.budgetExceeded = budgetExceeded;
+	if (mainGroup >= 0) {
+		fitResult.quality = groups.at(mainGroup).fit->getQuality(mainPeak - groups.at(mainGroup).firstPeak);
+	}
+	emit multiPeakFitCalculated(positions, fwhms);
+
+	//fitted curve for plot. samples outside of all fit windows are NaN, so the plot shows gaps there. x values are sample numbers of the roi, the data may be upsampled
+	int samples = xValues.isEmpty() ? 0 : qRound(xValues.last() - xValues.first()) + 1;
+	int fitLength = samples * 10;
+	fitX.resize(fitLength);
+	fitY.resize(fitLength);
+	double step = static_cast<double>(samples)/static_cast<double>(fitLength);
+	for (int i = 0; i < fitLength; i++) {
+		fitX[i] = xValues.at(0) + step*i;
+		fitY[i] = qQNaN();
+	}
+	int fitIndex = 0;
+	for (int i = 0; i < groups.size(); i++) {
+		const PeakGroup& group = groups.at(i);
+		while (fitIndex < fitLength && fitX.at(fitIndex) < xValues.at(group.left)) {
+			fitIndex++;
+		}
+		int first = fitIndex;
+		while (fitIndex < fitLength && fitX.at(fitIndex) <= xValues.at(group.right)) {
+			fitIndex++;
+		}
+		group.fit->evaluate(fitX.constData() + first, fitY.data() + first, fitIndex - first);
+	}
+}
 
-		this->isPeakFitting = false;
+void PeakFit::cropToFitWindow(QVector<qreal>& xValues, QVector<qreal>& yValues) {
+	//only samples within +-k*sigma around the peak are fitted. sigma is estimated from the half maximum width of the current frame, so the window follows the peak
+	//and the number of samples depends on the width of the PSF instead of the width of the roi
+	int samples = xValues.size();
+	HalfMaximumWidth::Result estimate = HalfMaximumWidth::calculate(xValues.constData(), yValues.constData(), samples, LINEAR_INTERPOLATION);
+	if (!estimate.valid) {
+		return; //no peak or peak too wide for the roi: complete roi is used
+	}
+	//x values are sample numbers of the frame, also if the line is upsampled. the minimum window is given in pixels of the frame, so it does not shrink with the upsampling factor
+	double spacing = (xValues.last() - xValues.first()) / (samples - 1);
+	double halfWidth = qMax(this->params.fitWindowSigmaFactor * estimate.fwhm / GAUSS_FWHM_FACTOR, 0.5 * PEAKFIT_FIT_WINDOW_MIN_SAMPLES);
+	int first = qMax(0, qFloor((estimate.peakPosition - halfWidth - xValues.first()) / spacing));
+	int last = qMin(samples-1, qCeil((estimate.peakPosition + halfWidth - xValues.first()) / spacing));
+	if (first == 0 && last == samples-1) {
+		return;
+	}
+	xValues = xValues.mid(first, last - first + 1);
+	yValues = yValues.mid(first, last - first + 1);
+}
+
+void PeakFit::setColdStartGuess(const QVector<qreal>& averagedLine) {
+	//all parameters are estimated in closed form. if this fails only the peak position and height are known
+	if (!this->gaussFit.estimateInitialGuess()) {
+		int maxPos = this->findMaxValuePosition(averagedLine);
+		double maxValue = averagedLine.at(qAbs(maxPos));
+		this->gaussFit.setInitialGuess(GaussParams::Constant(GAUSSFIT_DEFAULT_INITIAL_GUESS));
+		this->gaussFit.setInitialGuessForM(maxPos);
+		this->gaussFit.setInitialGuessForA(maxValue);
 	}
 }
 
+void PeakFit::averageOverFrames(QVector<qreal>& averagedLine) {
+	//only the roi part of the line is averaged, the rest of the line is not used for the fit
+	QRect roi = this->params.roi.normalized();
+	int start = qBound(0, roi.x(), averagedLine.size());
+	int end = qBound(start, roi.x() + roi.width(), averagedLine.size());
+	if (end > start) {
+		this->temporalAverage.add(averagedLine.constData() + start, end - start, averagedLine.data() + start);
+	}
+}
+
+void PeakFit::fitLateralProfile(FrameSlot* frame) {
+	//only frame data contains the single A-scans, column sums of the fused ingest do not
+	if (frame->content != FRAME_DATA) {
+		return;
+	}
+	QRect dataRect(frame->originX, frame->originY, frame->samplesPerLine, frame->linesPerFrame);
+	QRect clampedRoi = this->clampRoiToSlot(frame);
+	if (clampedRoi.width() <= 0 || clampedRoi.height() <= 0) {
+		return;
+	}
+
+	QVector<qreal> peakPositions;
+	QVector<qreal> fwhms;
+	this->lateralProfileFit.setRobustLoss(this->params.robustLoss);
+	this->lateralProfileFit.setWarmStartEnabled(this->params.fitWarmStartEnabled);
+	this->lateralProfileFit.setTimeBudget(this->params.fitTimeBudgetUs);
+	if (!this->lateralProfileFit.fit(frame->data, frame->pixelType, dataRect.width(), clampedRoi.x() - dataRect.x(), clampedRoi.y() - dataRect.y(), clampedRoi.width(), clampedRoi.height(), peakPositions, fwhms)) {
+		emit error(tr("Lateral profile could not be fitted."));
+		return;
+	}
+
+	//peak positions are relative to the data in the slot, which may only contain the roi
+	QVector<qreal> lines(clampedRoi.height());
+	for (int i = 0; i < clampedRoi.height(); i++) {
+		lines[i] = clampedRoi.y() + i;
+		peakPositions[i] += dataRect.x();
+	}
+	emit lateralProfileCalculated(lines, peakPositions, fwhms);
+}
+
+QRect PeakFit::clampRoiToSlot(FrameSlot* frame) {
+	//frame slot may only contain a part of the frame. only the part of the roi that is available in the slot can be used
+	QRect dataRect(frame->originX, frame->originY, frame->samplesPerLine, frame->linesPerFrame);
+	return this->clampRoi(this->params.roi, frame->frameSamplesPerLine, frame->frameLinesPerFrame).intersected(dataRect);
+}
+
 void PeakFit::setRoi(QRect roi) {
+	if (roi == this->params.roi) {
+		return;
+	}
+	this->warmStartValid = false;
+	this->temporalAverage.reset();
 	this->params.roi = roi;
+	this->lastAveragedLineValid = false;
+	this->requestReanalysis();
 }
 
 int PeakFit::findMaxValuePosition(const QVector<qreal>& line) {
@@ -128,18 +674,66 @@ QRect PeakFit::clampRoi(QRect roi, unsigned int samplesPerLine, unsigned int lin
 	return clampedRoi;
 }
 
-QVector<qreal> PeakFit::calculateAveragedLine(void *frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame) {
-	QVector<qreal> averagedLine;
+QVector<qreal> PeakFit::calculateAveragedLine(FrameSlot* frame) {
+	unsigned int samplesPerLine = frame->frameSamplesPerLine;
+	QVector<qreal> averagedLine(samplesPerLine, 0);
+
+	//column sums may already have been calculated at ingest. the analyzer does not fuse the reduction into ingest for other projections than the mean
+	if (frame->content == COLUMN_SUMS) {
+		const double* sums = static_cast<const double*>(frame->data);
+		int linesSummed = static_cast<int>(frame->linesPerFrame);
+		if (linesSummed <= 0) {
+			return averagedLine;
+		}
+		for (unsigned int i = 0; i < frame->samplesPerLine; i++) {
+			averagedLine[frame->originX + i] = sums[i] / linesSummed;
+		}
+		return averagedLine;
+	}
+
+	//only the part of the roi that is available in the slot can be used
+	QRect dataRect(frame->originX, frame->originY, frame->samplesPerLine, frame->linesPerFrame);
+	QRect clampedRoi = this->clampRoiToSlot(frame);
+	int roiY = clampedRoi.y();
+	int roiHeight = clampedRoi.height();
+	int roiX = clampedRoi.x();
+	int roiWidth = clampedRoi.width();
+
+	//if roi is out of the frame clampedRoi(..) will return a QRect with 0 width and 0 height
+	if (roiWidth <= 0 || roiHeight <= 0) {
+		return averagedLine;
+	}
 
-	if (bitDepth <= 8) {
-		unsigned char* frame = static_cast<unsigned char*>(frameBuffer);
-		averagedLine = this->calculateAveragedLine<unsigned char>(this->params.roi, frame, samplesPerLine, linesPerFrame);
-	} else if (bitDepth > 8 && bitDepth <= 16) {
-		unsigned short* frame = static_cast<unsigned short*>(frameBuffer);
-		averagedLine = this->calculateAveragedLine<unsigned short>(this->params.roi, frame, samplesPerLine, linesPerFrame);
-	} else if (bitDepth > 16 && bitDepth <= 32) {
-		unsigned long* frame = static_cast<unsigned long*>(frameBuffer);
-		averagedLine = this->calculateAveragedLine<unsigned long>(this->params.roi, frame, samplesPerLine, linesPerFrame);
+	//robust alternatives to the mean (median, trimmed mean, maximum) are order statistics of each column of the roi
+	qint64 roiSamples = static_cast<qint64>(roiWidth)*roiHeight;
+	bool parallel = this->params.parallelReductionThreshold > 0 && roiSamples >= this->params.parallelReductionThreshold;
+	if (this->params.lineProjection != MEAN_PROJECTION) {
+		QVector<qreal> projectedLine(roiWidth, 0);
+		if (parallel) {
+			this->columnProjection.projectParallel(frame->data, frame->pixelType, dataRect.width(), roiX - dataRect.x(), roiY - dataRect.y(), roiWidth, roiHeight, this->params.lineProjection, this->params.projectionTrimFraction, projectedLine.data());
+		} else {
+			this->columnProjection.project(frame->data, frame->pixelType, dataRect.width(), roiX - dataRect.x(), roiY - dataRect.y(), roiWidth, roiHeight, this->params.lineProjection, this->params.projectionTrimFraction, projectedLine.data());
+		}
+		for (int i = 0; i < roiWidth; i++) {
+			averagedLine[roiX + i] = projectedLine[i];
+		}
+		return averagedLine;
+	}
+
+	//sum up the values within roi. large rois (e.g. full frame to average out speckle) are split across a worker pool. a threshold <= 0 disables the parallel reduction.
+	//if the summed-area table of this frame has already been built the sums are taken from it
+	QVector<qreal> sumLine(roiWidth, 0);
+	if (this->prefixSum.isValid() && frame == this->lastFrame) {
+		this->prefixSum.sum(roiX - dataRect.x(), roiY - dataRect.y(), roiWidth, roiHeight, sumLine.data());
+	} else if (parallel) {
+		ColumnSum::accumulateParallel(frame->data, frame->pixelType, dataRect.width(), roiX - dataRect.x(), roiY - dataRect.y(), roiWidth, roiHeight, sumLine.data());
+	} else {
+		ColumnSum::accumulate(frame->data, frame->pixelType, dataRect.width(), roiX - dataRect.x(), roiY - dataRect.y(), roiWidth, roiHeight, sumLine.data());
+	}
+
+	// compute average per column in ROI
+	for (int i = 0; i < roiWidth; i++) {
+		averagedLine[roiX + i] = sumLine[i] / roiHeight;
 	}
 
 	return averagedLine;
@@ -165,36 +759,3 @@ QPair<QVector<qreal>, QVector<qreal> > PeakFit::clampLine(QVector<qreal> line, i
 
 	return QPair<QVector<qreal>, QVector<qreal>>(clampedXValues, clampedYValues);
 }
-
-template<typename T>
-QVector<qreal> PeakFit::calculateAveragedLine(QRect roi, T* frame, unsigned int samplesPerLine, unsigned int linesPerFrame) {
-	QVector<qreal> averagedLine(samplesPerLine, 0);
-	QRect clampedRoi = this->clampRoi(roi, samplesPerLine, linesPerFrame);
-	int roiY = clampedRoi.y();
-	int roiHeight = clampedRoi.height();
-	int roiX = clampedRoi.x();
-	int roiWidth = clampedRoi.width();
-
-	//if roi is out of the frame clampedRoi(..) will return a QRect with 0 width and 0 height
-	if (roiWidth <= 0 || roiHeight <= 0) {
-		return averagedLine;
-	}
-
-	//loop through ROI and sum up the values
-	int endY = roiY + roiHeight;
-	int endX = roiX + roiWidth;
-	QVector<qreal> sumLine(roiWidth, 0);
-
-	for (int y = roiY; y < endY; y++) {
-		for (int x = roiX; x < endX; x++) {
-			sumLine[x - roiX] += frame[y * samplesPerLine + x];
-		}
-	}
-
-	// compute average per column in ROI
-	for (int i = 0; i < roiWidth; i++) {
-		averagedLine[roiX + i] = sumLine[i] / roiHeight;
-	}
-
-	return averagedLine;
-}
@@ -7,23 +7,89 @@
 #include <QApplication>
 #include <QtMath>
 #include <QPair>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QAtomicInteger>
 #include "axialpsfanalyzerparameters.h"
+#include "framering.h"
+#include "gaussfit.h"
+#include "psfmodelfit.h"
+#include "psfmultipeakfit.h"
+#include "fitresult.h"
+#include "lateralprofilefit.h"
+#include "sincupsampler.h"
+#include "temporalaverage.h"
+#include "columnprefixsum.h"
+#include "columnprojection.h"
+
+#define PEAKFIT_WARM_START_MAX_RESIDUAL_INCREASE 1.5 //warm started fit is discarded if its relative rms residual is larger than the previous one by this factor
+#define PEAKFIT_QUALITY_LOG_INTERVAL 100 //fit quality is logged every n-th fit during auto fetching
+#define PEAKFIT_FIT_WINDOW_MIN_SAMPLES 16 //adaptive fit window is never smaller than this number of pixels of the frame (not upsampled samples), narrow peaks still need some samples of the offset
 
 
 class PeakFit : public QObject
 {
 	Q_OBJECT
 public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW //gaussFit has fixed-size Eigen members
+
 	explicit PeakFit(QObject *parent = nullptr);
+	~PeakFit();
+
+	static QRect clampRoi(QRect roi, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	static bool changesAnalysis(const AxialPsfAnalyzerParameters& previous, const AxialPsfAnalyzerParameters& current); //true if the result of the last frame is different with the current parameters
+
+	//thread safe. must be called directly (not queued) with every new set of parameters before they are passed to setParams(..), so an analysis that is still running with outdated parameters is abandoned
+	void invalidate(AxialPsfAnalyzerParameters params);
 
 private:
 	bool isPeakFitting;
 	AxialPsfAnalyzerParameters params;
+	GaussFit gaussFit;
+	bool warmStartValid;
+	GaussParams lastFitParams;
+	double lastRelativeRms;
+	quint64 fitCount;
+	quint64 budgetExceededCount;
+	QString modelName;
+	AbstractPsfModelFit* modelFit; //nullptr for the Gaussian, which is fitted with gaussFit
+	QVector<AbstractPsfMultiPeakFit*> multiPeakFits; //one per group of overlapping peaks, used if more than one peak is fitted
+	LateralProfileFit lateralProfileFit;
+	SincUpsampler upsampler;
+	TemporalAverage temporalAverage; //roi part of the averaged lines of the last fetched frames
+	QVector<qreal> upsampledX; //upsampled roi window, kept for the next frame so its memory is only allocated once
+	QVector<qreal> upsampledY;
+	FrameSlot* lastFrame; //most recently fitted frame, its slot is kept until the next frame arrives so it can be analyzed again without acquisition
+	ColumnPrefixSum prefixSum; //summed-area table of lastFrame, built with the first roi change after a new frame
+	ColumnProjection columnProjection; //median, trimmed mean and maximum of the roi lines, keeps its buffers for the next frame
+	QVector<qreal> lastAveragedLine; //averaged line of lastFrame (after temporal averaging)
+	bool lastAveragedLineValid; //false if roi or projection changed since lastAveragedLine was calculated
+	bool reanalysisPending;
+	QAtomicInteger<quint64> generation; //incremented with every change of roi or parameters that changes the result
+	quint64 analyzedGeneration; //generation of the last analysis whose results were emitted
+	FitResult lastFitResult;
+	quint64 unchangedFrameCount; //frames that were not analyzed because their roi fingerprint matched the last frame
+	QMutex requestedParamsMutex;
+	AxialPsfAnalyzerParameters requestedParams; //parameters of the last invalidate(..) call
+	bool requestedParamsValid;
 
 	int findMaxValuePosition(const QVector<qreal>& line);
-	QRect clampRoi(QRect roi, unsigned int samplesPerLine, unsigned int linesPerFrame);
-	QVector<qreal> calculateAveragedLine(void* frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
-	template <typename T> QVector<qreal> calculateAveragedLine(QRect roi, T* frame, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	void fitAveragedLine(const QVector<qreal>& averagedLine);
+	void fitGauss(const QVector<qreal>& averagedLine, const QVector<qreal>& xValues, const QVector<qreal>& yValues, FitResult& fitResult);
+	void fitModel(const QVector<qreal>& xValues, const QVector<qreal>& yValues, FitResult& fitResult);
+	void fitMultiplePeaks(const QVector<qreal>& xValues, const QVector<qreal>& yValues, FitResult& fitResult, QVector<qreal>& fitX, QVector<qreal>& fitY);
+	void setModel(const QString& name);
+	void cropToFitWindow(QVector<qreal>& xValues, QVector<qreal>& yValues);
+	void setColdStartGuess(const QVector<qreal>& averagedLine);
+	void averageOverFrames(QVector<qreal>& averagedLine);
+	void fitLateralProfile(FrameSlot* frame);
+	QRect clampRoiToSlot(FrameSlot* frame);
+	QVector<qreal> calculateAveragedLine(FrameSlot* frame);
+	void retainFrame(FrameSlot* frame);
+	void analyzeLastFrame();
+	bool isStale(quint64 generation) const;
+	void requestReanalysis();
+	void emitFitResult(const FitResult& fitResult);
 	QPair<QVector<qreal>, QVector<qreal>> clampLine(QVector<qreal> line, int startIndex, int endIndex);
 
 signals:
@@ -31,13 +97,20 @@ signals:
 	void fitCalculated(QVector<qreal> x, QVector<qreal> y);
 	void peakPositionFound(double pos);
 	void fwhmCalculated(double fwhm);
+	void halfMaxFwhmCalculated(double fwhm);
+	void multiPeakFitCalculated(QVector<qreal> positions, QVector<qreal> fwhms);
+	void lateralProfileCalculated(QVector<qreal> lines, QVector<qreal> peakPositions, QVector<qreal> fwhms);
+	void fitResultCalculated(FitResult result);
 	void info(QString);
 	void error(QString);
 
 public slots:
-	void fitPeak(void* frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	void fitPeak(FrameSlot* frame);
 	void setRoi(QRect roi);
 	void setParams(AxialPsfAnalyzerParameters params);
+
+private slots:
+	void reanalyze();
 };
 
 #endif //PEAKFIT
@@ -0,0 +1,67 @@
+#ifndef PIXELTYPE_H
+#define PIXELTYPE_H
+
+#include <QtGlobal>
+#include <utility>
+
+enum SAMPLE_FORMAT{
+	UNSIGNED_INTEGER,
+	SIGNED_INTEGER,
+	FLOATING_POINT
+};
+
+enum PIXEL_TYPE{
+	PIXEL_INVALID,
+	PIXEL_UINT8,
+	PIXEL_UINT16,
+	PIXEL_UINT32,
+	PIXEL_INT8,
+	PIXEL_INT16,
+	PIXEL_INT32,
+	PIXEL_FLOAT32
+};
+
+
+//maps the bit depth reported by OCTproZ and the sample format to the type that is used to store one sample in memory.
+//all frame consumers (peak fit, bit depth converter, ingest) use this table, so every bit depth is read with the correct sample size.
+class PixelType
+{
+public:
+	static constexpr PIXEL_TYPE fromBitDepth(unsigned int bitDepth, SAMPLE_FORMAT format) {
+		return (bitDepth == 0 || bitDepth > 32) ? PIXEL_INVALID :
+			format == FLOATING_POINT ? (bitDepth == 32 ? PIXEL_FLOAT32 : PIXEL_INVALID) :
+			format == SIGNED_INTEGER ? (bitDepth <= 8 ? PIXEL_INT8 : bitDepth <= 16 ? PIXEL_INT16 : PIXEL_INT32) :
+			(bitDepth <= 8 ? PIXEL_UINT8 : bitDepth <= 16 ? PIXEL_UINT16 : PIXEL_UINT32);
+	}
+
+	static constexpr size_t bytesPerSample(PIXEL_TYPE pixelType) {
+		return (pixelType == PIXEL_UINT8 || pixelType == PIXEL_INT8) ? 1 :
+			(pixelType == PIXEL_UINT16 || pixelType == PIXEL_INT16) ? 2 :
+			(pixelType == PIXEL_INVALID) ? 0 : 4;
+	}
+
+	//calls Kernel<T>::run(args...) with the sample type T that belongs to pixelType. returns false for PIXEL_INVALID
+	template <template <typename> class Kernel, typename... Args>
+	static bool dispatch(PIXEL_TYPE pixelType, Args&&... args) {
+		switch (pixelType) {
+		case PIXEL_UINT8: Kernel<quint8>::run(std::forward<Args>(args)...); return true;
+		case PIXEL_UINT16: Kernel<quint16>::run(std::forward<Args>(args)...); return true;
+		case PIXEL_UINT32: Kernel<quint32>::run(std::forward<Args>(args)...); return true;
+		case PIXEL_INT8: Kernel<qint8>::run(std::forward<Args>(args)...); return true;
+		case PIXEL_INT16: Kernel<qint16>::run(std::forward<Args>(args)...); return true;
+		case PIXEL_INT32: Kernel<qint32>::run(std::forward<Args>(args)...); return true;
+		case PIXEL_FLOAT32: Kernel<float>::run(std::forward<Args>(args)...); return true;
+		default: return false;
+		}
+	}
+};
+
+//the table is evaluated at compile time
+static_assert(PixelType::fromBitDepth(8, UNSIGNED_INTEGER) == PIXEL_UINT8, "8 bit data must be read as 1 byte samples");
+static_assert(PixelType::fromBitDepth(12, UNSIGNED_INTEGER) == PIXEL_UINT16, "9 to 16 bit data must be read as 2 byte samples");
+static_assert(PixelType::fromBitDepth(24, UNSIGNED_INTEGER) == PIXEL_UINT32, "17 to 32 bit data must be read as 4 byte samples");
+static_assert(PixelType::fromBitDepth(32, FLOATING_POINT) == PIXEL_FLOAT32, "32 bit floating point data must be read as float");
+static_assert(sizeof(float) == 4, "float must be 4 bytes");
+static_assert(PixelType::bytesPerSample(PIXEL_UINT32) == sizeof(quint32), "unexpected sample size");
+
+#endif //PIXELTYPE_H
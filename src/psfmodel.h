@@ -0,0 +1,300 @@
+#ifndef PSFMODEL_H
+#define PSFMODEL_H
+
+#include <QtMath>
+#include <Eigen/Dense>
+#include "gaussfunction.h"
+#include "halfmaximumwidth.h"
+
+#define LORENTZ_FWHM_FACTOR 2.0 //FWHM = 2*gamma
+#define SINC_SQUARED_FWHM_FACTOR 0.8858929414 //sinc^2(u) = 0.5 at u = +-0.44295
+#define HANN_FWHM_FACTOR 1.4405825801 //main lobe of the Hann window spectrum (squared) is at 0.5 at u = +-0.72029
+#define PSF_MODEL_SMALL_ARGUMENT 1e-4 //sinc and its derivative are evaluated with a Taylor series below this argument
+
+
+//PSF models that can be fitted with PsfModelFit. every model is a struct with static functions only, so the fit is compiled as a specialization with fixed number of parameters.
+//all models share the layout of the first three parameters: a (peak value), k (vertical offset), m (peak position). the remaining parameters describe the shape.
+//
+//a model provides:
+//	enum { ParameterCount = n };
+//	static const char* name(); //unique name that is used for the registry and the settings
+//	static const char* displayName();
+//	static double value(const Params& params, double x);
+//	static double valueAndGradient(const Params& params, double x, Params& gradient); //gradient of value with respect to the parameters
+//	static double fwhm(const Params& params);
+//	static void initialGuess(const HalfMaximumWidth::Result& estimate, Params& params); //parameters from the non-parametric estimate of the averaged line
+//	static void constrain(Params& params); //called after every fit step, e.g. to keep mixing factors in range
+
+
+//sin(pi*u)/(pi*u) and its derivative with respect to u
+inline void psfModelSinc(double u, double& sinc, double& derivative) {
+	if (qAbs(u) < PSF_MODEL_SMALL_ARGUMENT) {
+		double piU = M_PI * u;
+		sinc = 1.0 - piU * piU / 6.0;
+		derivative = -M_PI * piU / 3.0;
+		return;
+	}
+	double piU = M_PI * u;
+	sinc = qSin(piU) / piU;
+	derivative = (qCos(piU) - sinc) / u;
+}
+
+//same as above with sin(pi*u) and cos(pi*u) already known, for models that evaluate several sinc terms of shifted arguments
+inline void psfModelSinc(double u, double sinPiU, double cosPiU, double& sinc, double& derivative) {
+	if (qAbs(u) < PSF_MODEL_SMALL_ARGUMENT) {
+		double piU = M_PI * u;
+		sinc = 1.0 - piU * piU / 6.0;
+		derivative = -M_PI * piU / 3.0;
+		return;
+	}
+	sinc = sinPiU / (M_PI * u);
+	derivative = (cosPiU - sinc) / u;
+}
+
+
+//k + (a-k) * exp(-(x-m)^2/(2s^2))
+struct GaussianModel {
+	enum { ParameterCount = 4 };
+	typedef Eigen::Matrix<double, ParameterCount, 1> Params; // a, k, m, s
+
+	static const char* name() { return "gaussian"; }
+	static const char* displayName() { return "Gaussian"; }
+
+	static double value(const Params& params, double x) {
+		double dx = x - params[2];
+		return params[1] + (params[0] - params[1]) * qExp(-(dx * dx) / (2.0 * params[3] * params[3]));
+	}
+
+	static double valueAndGradient(const Params& params, double x, Params& gradient) {
+		const double s2 = params[3] * params[3];
+		const double dx = x - params[2];
+		const double e = qExp(-(dx * dx) / (2.0 * s2));
+		const double amplitudeTerm = (params[0] - params[1]) * e * dx / s2;
+		gradient[0] = e;
+		gradient[1] = 1.0 - e;
+		gradient[2] = amplitudeTerm;
+		gradient[3] = amplitudeTerm * dx / params[3];
+		return params[1] + (params[0] - params[1]) * e;
+	}
+
+	static double fwhm(const Params& params) { return qAbs(GAUSS_FWHM_FACTOR * params[3]); }
+
+	static void initialGuess(const HalfMaximumWidth::Result& estimate, Params& params) {
+		params << estimate.peakValue, estimate.baseline, estimate.peakPosition, estimate.fwhm / GAUSS_FWHM_FACTOR;
+	}
+
+	static void constrain(Params& params) { params[3] = qAbs(params[3]); }
+};
+
+
+//k + (a-k) / (1 + ((x-m)/gamma)^2)
+struct LorentzianModel {
+	enum { ParameterCount = 4 };
+	typedef Eigen::Matrix<double, ParameterCount, 1> Params; // a, k, m, gamma
+
+	static const char* name() { return "lorentzian"; }
+	static const char* displayName() { return "Lorentzian"; }
+
+	static double value(const Params& params, double x) {
+		double u = (x - params[2]) / params[3];
+		return params[1] + (params[0] - params[1]) / (1.0 + u * u);
+	}
+
+	static double valueAndGradient(const Params& params, double x, Params& gradient) {
+		const double u = (x - params[2]) / params[3];
+		const double l = 1.0 / (1.0 + u * u);
+		const double shapeTerm = (params[0] - params[1]) * 2.0 * u * l * l / params[3]; //-d(value)/du / gamma
+		gradient[0] = l;
+		gradient[1] = 1.0 - l;
+		gradient[2] = shapeTerm;
+		gradient[3] = shapeTerm * u;
+		return params[1] + (params[0] - params[1]) * l;
+	}
+
+	static double fwhm(const Params& params) { return qAbs(LORENTZ_FWHM_FACTOR * params[3]); }
+
+	static void initialGuess(const HalfMaximumWidth::Result& estimate, Params& params) {
+		params << estimate.peakValue, estimate.baseline, estimate.peakPosition, estimate.fwhm / LORENTZ_FWHM_FACTOR;
+	}
+
+	static void constrain(Params& params) { params[3] = qAbs(params[3]); }
+};
+
+
+//k + (a-k) * sinc^2((x-m)/w). PSF of a spectrum with rectangular window, w is the distance between peak and first zero
+struct SincSquaredModel {
+	enum { ParameterCount = 4 };
+	typedef Eigen::Matrix<double, ParameterCount, 1> Params; // a, k, m, w
+
+	static const char* name() { return "sinc_squared"; }
+	static const char* displayName() { return "Sinc²"; }
+
+	static double value(const Params& params, double x) {
+		double sinc, derivative;
+		psfModelSinc((x - params[2]) / params[3], sinc, derivative);
+		return params[1] + (params[0] - params[1]) * sinc * sinc;
+	}
+
+	static double valueAndGradient(const Params& params, double x, Params& gradient) {
+		const double u = (x - params[2]) / params[3];
+		double sinc, derivative;
+		psfModelSinc(u, sinc, derivative);
+		const double shape = sinc * sinc;
+		const double shapeTerm = -(params[0] - params[1]) * 2.0 * sinc * derivative / params[3]; //-d(value)/du / w
+		gradient[0] = shape;
+		gradient[1] = 1.0 - shape;
+		gradient[2] = shapeTerm;
+		gradient[3] = shapeTerm * u;
+		return params[1] + (params[0] - params[1]) * shape;
+	}
+
+	static double fwhm(const Params& params) { return qAbs(SINC_SQUARED_FWHM_FACTOR * params[3]); }
+
+	static void initialGuess(const HalfMaximumWidth::Result& estimate, Params& params) {
+		params << estimate.peakValue, estimate.baseline, estimate.peakPosition, estimate.fwhm / SINC_SQUARED_FWHM_FACTOR;
+	}
+
+	static void constrain(Params& params) { params[3] = qAbs(params[3]); }
+};
+
+
+//k + (a-k) * h^2((x-m)/w) with h(u) = sinc(u) + 0.5*sinc(u-1) + 0.5*sinc(u+1), the (normalized) Fourier transform of a Hann window.
+//PSF of a Hann windowed spectrum, i.e. sinc^2 convolved with the window. w is one bin, the first zero is at 2w
+struct HannModel {
+	enum { ParameterCount = 4 };
+	typedef Eigen::Matrix<double, ParameterCount, 1> Params; // a, k, m, w
+
+	static const char* name() { return "hann"; }
+	static const char* displayName() { return "Hann windowed sinc²"; }
+
+	static double value(const Params& params, double x) {
+		double h, derivative;
+		shape((x - params[2]) / params[3], h, derivative);
+		return params[1] + (params[0] - params[1]) * h * h;
+	}
+
+	static double valueAndGradient(const Params& params, double x, Params& gradient) {
+		const double u = (x - params[2]) / params[3];
+		double h, derivative;
+		shape(u, h, derivative);
+		const double squaredShape = h * h;
+		const double shapeTerm = -(params[0] - params[1]) * 2.0 * h * derivative / params[3]; //-d(value)/du / w
+		gradient[0] = squaredShape;
+		gradient[1] = 1.0 - squaredShape;
+		gradient[2] = shapeTerm;
+		gradient[3] = shapeTerm * u;
+		return params[1] + (params[0] - params[1]) * squaredShape;
+	}
+
+	static double fwhm(const Params& params) { return qAbs(HANN_FWHM_FACTOR * params[3]); }
+
+	static void initialGuess(const HalfMaximumWidth::Result& estimate, Params& params) {
+		params << estimate.peakValue, estimate.baseline, estimate.peakPosition, estimate.fwhm / HANN_FWHM_FACTOR;
+	}
+
+	static void constrain(Params& params) { params[3] = qAbs(params[3]); }
+
+private:
+	//sin(pi*(u+-1)) = -sin(pi*u) and cos(pi*(u+-1)) = -cos(pi*u), so the three sinc terms only need one sin and one cos
+	static void shape(double u, double& h, double& derivative) {
+		const double sinPiU = qSin(M_PI * u);
+		const double cosPiU = qCos(M_PI * u);
+		double sinc0, derivative0, sincLeft, derivativeLeft, sincRight, derivativeRight;
+		psfModelSinc(u, sinPiU, cosPiU, sinc0, derivative0);
+		psfModelSinc(u - 1.0, -sinPiU, -cosPiU, sincLeft, derivativeLeft);
+		psfModelSinc(u + 1.0, -sinPiU, -cosPiU, sincRight, derivativeRight);
+		h = sinc0 + 0.5 * (sincLeft + sincRight);
+		derivative = derivative0 + 0.5 * (derivativeLeft + derivativeRight);
+	}
+};
+
+
+//k + (a-k) * (eta*L(x) + (1-eta)*G(x)), Lorentzian L and Gaussian G with the same FWHM f
+struct PseudoVoigtModel {
+	enum { ParameterCount = 5 };
+	typedef Eigen::Matrix<double, ParameterCount, 1> Params; // a, k, m, f, eta
+
+	static const char* name() { return "pseudo_voigt"; }
+	static const char* displayName() { return "Pseudo-Voigt"; }
+
+	static double value(const Params& params, double x) {
+		const double u = (x - params[2]) / params[3];
+		const double l = 1.0 / (1.0 + 4.0 * u * u);
+		const double g = qExp(-4.0 * M_LN2 * u * u);
+		return params[1] + (params[0] - params[1]) * (params[4] * l + (1.0 - params[4]) * g);
+	}
+
+	static double valueAndGradient(const Params& params, double x, Params& gradient) {
+		const double u = (x - params[2]) / params[3];
+		const double eta = params[4];
+		const double l = 1.0 / (1.0 + 4.0 * u * u);
+		const double g = qExp(-4.0 * M_LN2 * u * u);
+		const double shape = eta * l + (1.0 - eta) * g;
+		const double shapeDerivative = eta * (-8.0 * u * l * l) + (1.0 - eta) * (-8.0 * M_LN2 * u * g);
+		const double shapeTerm = -(params[0] - params[1]) * shapeDerivative / params[3]; //-d(value)/du / f
+		gradient[0] = shape;
+		gradient[1] = 1.0 - shape;
+		gradient[2] = shapeTerm;
+		gradient[3] = shapeTerm * u;
+		gradient[4] = (params[0] - params[1]) * (l - g);
+		return params[1] + (params[0] - params[1]) * shape;
+	}
+
+	static double fwhm(const Params& params) { return qAbs(params[3]); }
+
+	static void initialGuess(const HalfMaximumWidth::Result& estimate, Params& params) {
+		params << estimate.peakValue, estimate.baseline, estimate.peakPosition, estimate.fwhm, 0.5;
+	}
+
+	static void constrain(Params& params) {
+		params[3] = qAbs(params[3]);
+		params[4] = qBound(0.0, params[4], 1.0);
+	}
+};
+
+
+//Gaussian with different standard deviations left (sL) and right (sR) of the peak
+struct AsymmetricGaussianModel {
+	enum { ParameterCount = 5 };
+	typedef Eigen::Matrix<double, ParameterCount, 1> Params; // a, k, m, sL, sR
+
+	static const char* name() { return "asymmetric_gaussian"; }
+	static const char* displayName() { return "Asymmetric Gaussian"; }
+
+	static double value(const Params& params, double x) {
+		const double dx = x - params[2];
+		const double s = dx < 0.0 ? params[3] : params[4];
+		return params[1] + (params[0] - params[1]) * qExp(-(dx * dx) / (2.0 * s * s));
+	}
+
+	static double valueAndGradient(const Params& params, double x, Params& gradient) {
+		const double dx = x - params[2];
+		const bool left = dx < 0.0;
+		const double s = left ? params[3] : params[4];
+		const double s2 = s * s;
+		const double e = qExp(-(dx * dx) / (2.0 * s2));
+		const double amplitudeTerm = (params[0] - params[1]) * e * dx / s2;
+		gradient[0] = e;
+		gradient[1] = 1.0 - e;
+		gradient[2] = amplitudeTerm;
+		gradient[3] = left ? amplitudeTerm * dx / s : 0.0;
+		gradient[4] = left ? 0.0 : amplitudeTerm * dx / s;
+		return params[1] + (params[0] - params[1]) * e;
+	}
+
+	static double fwhm(const Params& params) { return 0.5 * GAUSS_FWHM_FACTOR * (qAbs(params[3]) + qAbs(params[4])); }
+
+	static void initialGuess(const HalfMaximumWidth::Result& estimate, Params& params) {
+		//half maximum crossings give the width on each side
+		params << estimate.peakValue, estimate.baseline, estimate.peakPosition,
+			2.0 * (estimate.peakPosition - estimate.leftCrossing) / GAUSS_FWHM_FACTOR,
+			2.0 * (estimate.rightCrossing - estimate.peakPosition) / GAUSS_FWHM_FACTOR;
+	}
+
+	static void constrain(Params& params) {
+		params[3] = qAbs(params[3]);
+		params[4] = qAbs(params[4]);
+	}
+};
+
+#endif //PSFMODEL_H
@@ -0,0 +1,228 @@
+#ifndef PSFMODELFIT_H
+#define PSFMODELFIT_H
+
+#include <QtGlobal>
+#include <QtMath>
+#include <QElapsedTimer>
+#include <QVector>
+#include <Eigen/Dense>
+#include <limits>
+#include "psfmodel.h"
+#include "optimizationfunctor.h"
+#include "robustweights.h"
+#include "halfmaximumwidth.h"
+#include "fitquality.h"
+#include "levenbergmarquardt.h"
+
+#define PSF_MODEL_DEFAULT_INITIAL_GUESS 10.0 //all parameters before the first initial guess, same as for GaussFit
+
+
+//derivative of Model::fwhm(..) with respect to the parameters (central differences, the FWHM is a simple closed-form expression of the shape parameters)
+template<typename Model>
+void psfModelFwhmGradient(const typename Model::Params& params, typename Model::Params& gradient) {
+	for (int i = 0; i < Model::ParameterCount; i++) {
+		typename Model::Params upper = params;
+		typename Model::Params lower = params;
+		double h = 1e-6 * qMax(1.0, qAbs(params[i]));
+		upper[i] += h;
+		lower[i] -= h;
+		gradient[i] = (Model::fwhm(upper) - Model::fwhm(lower)) / (2.0 * h);
+	}
+}
+
+
+//interface of a fit of one PSF model. virtual functions are only called once per frame, everything that runs once per sample is inside the model specialization
+class AbstractPsfModelFit
+{
+public:
+	virtual ~AbstractPsfModelFit() {}
+
+	virtual const char* getModelName() const = 0;
+	virtual int getParameterCount() const = 0;
+	virtual void setData(const double* xData, const double* yData, int size) = 0;
+	virtual bool estimateInitialGuess(bool keepShape) = 0; //initial guess from the half maximum estimate of the data. keepShape keeps offset and shape of the current parameters (warm start) and only updates peak value and position
+	virtual void fit() = 0;
+	virtual void setRobustLoss(ROBUST_LOSS loss) = 0; //see GaussFit::setRobustLoss(..)
+	virtual void setTimeBudget(int timeBudgetUs) = 0; //fit() stops after timeBudgetUs microseconds and keeps the best parameters found so far. 0 disables
+	virtual void evaluate(const double* x, double* y, int size) const = 0; //fitted model at x
+	virtual QVector<double> getParams() const = 0;
+	virtual double getFWHM() const = 0;
+	virtual double getPeakPosition() const = 0;
+	virtual int getEvaluations() const = 0;
+	virtual bool isBudgetExceeded() const = 0;
+	virtual double getRelativeRms() const = 0; //rms of residuals of the last fit relative to peak height a-k
+	virtual bool isValid() const = 0; //parameters of the last fit are finite and the peak lies within the data
+	virtual FitQuality getQuality() const = 0;
+};
+
+
+//Levenberg-Marquardt fit of a PSF model with the number of parameters fixed at compile time. the normal equations come from PsfModelFunctor<Model>.
+//sample buffers are only reallocated if the number of samples grows, so an object that is reused for every frame does not allocate heap memory while fitting.
+template<typename Model>
+class PsfModelFit : public AbstractPsfModelFit
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW //fixed-size Eigen members need aligned allocation, PsfModelFit is always created with new by the registry
+
+	typedef typename Model::Params Params;
+
+	PsfModelFit()
+		: size(0),
+		evaluations(0),
+		cost(std::numeric_limits<double>::infinity()),
+		timeBudgetUs(0),
+		budgetExceeded(false),
+		robustLoss(LEAST_SQUARES_LOSS)
+	{
+		this->params.setConstant(PSF_MODEL_DEFAULT_INITIAL_GUESS);
+		this->normalMatrix.setZero();
+	}
+
+	const char* getModelName() const override { return Model::name(); }
+	int getParameterCount() const override { return Model::ParameterCount; }
+
+	void setData(const double* xData, const double* yData, int size) override {
+		//buffers only grow, smaller data sets use the first size elements
+		if (this->xData.size() < size) {
+			this->xData.resize(size);
+			this->yData.resize(size);
+		}
+		for (int i = 0; i < size; i++) {
+			this->xData[i] = xData[i];
+			this->yData[i] = yData[i];
+		}
+		this->size = size;
+	}
+
+	bool estimateInitialGuess(bool keepShape) override {
+		HalfMaximumWidth::Result estimate = HalfMaximumWidth::calculate(this->xData.data(), this->yData.data(), this->size, LINEAR_INTERPOLATION);
+		if (!qIsFinite(estimate.peakPosition)) {
+			return false;
+		}
+		//peak is too wide for the roi: width is only a rough guess
+		if (!estimate.valid) {
+			estimate.fwhm = 0.5 * (this->xData[this->size-1] - this->xData[0]);
+			estimate.leftCrossing = estimate.peakPosition - 0.5 * estimate.fwhm;
+			estimate.rightCrossing = estimate.peakPosition + 0.5 * estimate.fwhm;
+		}
+		Params guess;
+		Model::initialGuess(estimate, guess);
+		if (keepShape) {
+			this->params[0] = guess[0];
+			this->params[2] = guess[2];
+		} else {
+			this->params = guess;
+		}
+		return true;
+	}
+
+	void fit() override {
+		QElapsedTimer timer;
+		timer.start();
+		PsfModelFunctor<Model> functor(this->xData.data(), this->yData.data(), this->size);
+		this->cost = levenbergMarquardt(functor, this->params, this->normalMatrix, this->timeBudgetUs, this->evaluations, this->budgetExceeded);
+		if (this->robustLoss == LEAST_SQUARES_LOSS || !qIsFinite(this->cost)) {
+			return;
+		}
+
+		//robust mode: iteratively reweighted least squares, see GaussFit::fit(). the weighted fits share the time budget of the first fit
+		if (this->robustWeights.size() < this->size) {
+			this->residuals.resize(this->size);
+			this->robustWeights.resize(this->size);
+			this->robustScratch.resize(this->size);
+		}
+		bool reweighted = false;
+		for (int iteration = 0; iteration < ROBUST_IRLS_MAX_ITERATIONS && !this->budgetExceeded; iteration++) {
+			for (int i = 0; i < this->size; i++) {
+				this->residuals[i] = this->yData[i] - Model::value(this->params, this->xData[i]);
+			}
+			if (!RobustWeights::calculate(this->robustLoss, this->residuals.data(), this->robustScratch.data(), this->robustWeights.data(), this->size)) {
+				break;
+			}
+			int remainingUs = 0;
+			if (this->timeBudgetUs > 0) {
+				remainingUs = this->timeBudgetUs - static_cast<int>(timer.nsecsElapsed() / 1000);
+				if (remainingUs <= 0) {
+					this->budgetExceeded = true;
+					break;
+				}
+			}
+			Params previousParams = this->params;
+			PsfModelFunctor<Model> weightedFunctor(this->xData.data(), this->yData.data(), this->size, this->robustWeights.data());
+			int weightedEvaluations = 0;
+			this->cost = levenbergMarquardt(weightedFunctor, this->params, this->normalMatrix, remainingUs, weightedEvaluations, this->budgetExceeded);
+			this->evaluations += weightedEvaluations;
+			reweighted = true;
+			if ((this->params - previousParams).norm() <= ROBUST_IRLS_TOLERANCE * this->params.norm()) {
+				break;
+			}
+		}
+
+		//quality and relative rms are calculated with the unweighted data, see GaussFit::fit()
+		if (reweighted) {
+			Params jtr;
+			this->cost = functor.normalEquations(this->params, this->normalMatrix, jtr);
+			this->evaluations++;
+		}
+	}
+
+	void setRobustLoss(ROBUST_LOSS loss) override { this->robustLoss = loss; }
+	void setTimeBudget(int timeBudgetUs) override { this->timeBudgetUs = timeBudgetUs; }
+
+	void evaluate(const double* x, double* y, int size) const override {
+		for (int i = 0; i < size; i++) {
+			y[i] = Model::value(this->params, x[i]);
+		}
+	}
+
+	QVector<double> getParams() const override {
+		QVector<double> params(Model::ParameterCount);
+		for (int i = 0; i < Model::ParameterCount; i++) {
+			params[i] = this->params[i];
+		}
+		return params;
+	}
+
+	double getFWHM() const override { return Model::fwhm(this->params); }
+	double getPeakPosition() const override { return this->params[2]; }
+	int getEvaluations() const override { return this->evaluations; }
+	bool isBudgetExceeded() const override { return this->budgetExceeded; }
+
+	double getRelativeRms() const override {
+		double peakHeight = qAbs(this->params[0] - this->params[1]);
+		if (this->size <= 0 || !(peakHeight > 0.0)) {
+			return std::numeric_limits<double>::infinity();
+		}
+		return qSqrt(this->cost / this->size) / peakHeight;
+	}
+
+	bool isValid() const override {
+		if (this->size <= 0 || !qIsFinite(this->cost) || !this->params.allFinite()) {
+			return false;
+		}
+		return this->params[2] >= this->xData[0] && this->params[2] <= this->xData[this->size-1];
+	}
+
+	FitQuality getQuality() const override {
+		Params fwhmGradient;
+		psfModelFwhmGradient<Model>(this->params, fwhmGradient);
+		return FitQuality::calculate(this->normalMatrix, fwhmGradient, 2, this->cost, this->yData.data(), this->size);
+	}
+
+private:
+	Eigen::VectorXd xData;
+	Eigen::VectorXd yData;
+	int size;
+	Params params;
+	typename PsfModelFunctor<Model>::NormalMatrixType normalMatrix; //J^T*J at the fitted parameters, for the parameter uncertainties
+	int evaluations;
+	double cost;
+	int timeBudgetUs;
+	bool budgetExceeded;
+	ROBUST_LOSS robustLoss;
+	Eigen::VectorXd residuals; //buffers for robust reweighting
+	Eigen::VectorXd robustWeights;
+	Eigen::VectorXd robustScratch;
+};
+
+#endif //PSFMODELFIT_H
@@ -0,0 +1,61 @@
+#include "psfmodelregistry.h"
+
+
+PsfModelRegistry::PsfModelRegistry() {
+	this->registerModel<GaussianModel>();
+	this->registerModel<LorentzianModel>();
+	this->registerModel<SincSquaredModel>();
+	this->registerModel<HannModel>();
+	this->registerModel<PseudoVoigtModel>();
+	this->registerModel<AsymmetricGaussianModel>();
+}
+
+PsfModelRegistry& PsfModelRegistry::instance() {
+	//thread-safe initialization of function-local statics is guaranteed since C++11
+	static PsfModelRegistry registry;
+	return registry;
+}
+
+bool PsfModelRegistry::contains(const QString& name) const {
+	for (int i = 0; i < this->entries.size(); i++) {
+		if (this->entries.at(i).name == name) {
+			return true;
+		}
+	}
+	return false;
+}
+
+QStringList PsfModelRegistry::getNames() const {
+	QStringList names;
+	for (int i = 0; i < this->entries.size(); i++) {
+		names.append(this->entries.at(i).name);
+	}
+	return names;
+}
+
+QString PsfModelRegistry::getDisplayName(const QString& name) const {
+	for (int i = 0; i < this->entries.size(); i++) {
+		if (this->entries.at(i).name == name) {
+			return this->entries.at(i).displayName;
+		}
+	}
+	return QString();
+}
+
+AbstractPsfModelFit* PsfModelRegistry::create(const QString& name) const {
+	for (int i = 0; i < this->entries.size(); i++) {
+		if (this->entries.at(i).name == name) {
+			return this->entries.at(i).create();
+		}
+	}
+	return nullptr;
+}
+
+AbstractPsfMultiPeakFit* PsfModelRegistry::createMultiPeak(const QString& name) const {
+	for (int i = 0; i < this->entries.size(); i++) {
+		if (this->entries.at(i).name == name) {
+			return this->entries.at(i).createMultiPeak();
+		}
+	}
+	return nullptr;
+}
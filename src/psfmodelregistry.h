@@ -0,0 +1,61 @@
+#ifndef PSFMODELREGISTRY_H
+#define PSFMODELREGISTRY_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "psfmodelfit.h"
+#include "psfmultipeakfit.h"
+
+#define PSF_MODEL_DEFAULT "gaussian"
+
+
+//all PSF models that can be fitted by name. the built-in models of psfmodel.h are registered on first use, further models can be added with registerModel<Model>()
+class PsfModelRegistry
+{
+public:
+	static PsfModelRegistry& instance();
+
+	template<typename Model>
+	void registerModel() {
+		if (this->contains(Model::name())) {
+			return;
+		}
+		Entry entry;
+		entry.name = Model::name();
+		entry.displayName = QString::fromUtf8(Model::displayName());
+		entry.create = &PsfModelRegistry::createFit<Model>;
+		entry.createMultiPeak = &PsfModelRegistry::createMultiPeakFit<Model>;
+		this->entries.append(entry);
+	}
+
+	bool contains(const QString& name) const;
+	QStringList getNames() const;
+	QString getDisplayName(const QString& name) const;
+	AbstractPsfModelFit* create(const QString& name) const; //new fit object, the caller takes ownership. nullptr if no model with this name is registered
+	AbstractPsfMultiPeakFit* createMultiPeak(const QString& name) const; //same as create(..) for a fit of several peaks
+
+private:
+	typedef AbstractPsfModelFit* (*FactoryFunction)();
+	typedef AbstractPsfMultiPeakFit* (*MultiPeakFactoryFunction)();
+	struct Entry {
+		QString name;
+		QString displayName;
+		FactoryFunction create;
+		MultiPeakFactoryFunction createMultiPeak;
+	};
+
+	PsfModelRegistry();
+	PsfModelRegistry(const PsfModelRegistry&) = delete;
+	PsfModelRegistry& operator=(const PsfModelRegistry&) = delete;
+
+	template<typename Model>
+	static AbstractPsfModelFit* createFit() { return new PsfModelFit<Model>(); }
+
+	template<typename Model>
+	static AbstractPsfMultiPeakFit* createMultiPeakFit() { return new PsfMultiPeakFit<Model>(); }
+
+	QVector<Entry> entries;
+};
+
+#endif //PSFMODELREGISTRY_H
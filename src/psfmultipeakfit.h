@@ -0,0 +1,162 @@
+#ifndef PSFMULTIPEAKFIT_H
+#define PSFMULTIPEAKFIT_H
+
+#include <QtGlobal>
+#include <QtMath>
+#include <Eigen/Dense>
+#include <limits>
+#include "psfmodelfit.h"
+#include "peakfinder.h"
+
+
+//interface of a fit of several peaks of one PSF model with a common offset. a single peak is the same as a fit of this peak in a local window
+class AbstractPsfMultiPeakFit
+{
+public:
+	virtual ~AbstractPsfMultiPeakFit() {}
+
+	virtual void setData(const double* xData, const double* yData, int size) = 0;
+	virtual void setInitialGuess(const PeakFinder::Peak* peaks, int peakCount) = 0; //one set of model parameters per detected peak, offset from the minimum of the data
+	virtual void fit() = 0;
+	virtual void setTimeBudget(int timeBudgetUs) = 0;
+	virtual void evaluate(const double* x, double* y, int size) const = 0; //sum of all fitted peaks at x
+	virtual int getPeakCount() const = 0;
+	virtual double getFWHM(int peak) const = 0;
+	virtual double getPeakPosition(int peak) const = 0;
+	virtual int getEvaluations() const = 0;
+	virtual bool isBudgetExceeded() const = 0;
+	virtual bool isValid() const = 0; //parameters are finite and every peak lies within the data
+	virtual FitQuality getQuality(int peak) const = 0; //goodness of fit of the complete window, uncertainties of position and FWHM of this peak
+};
+
+
+//Levenberg-Marquardt fit of the sum of several peaks of Model with PsfMultiPeakFunctor<Model>. the parameter vector grows with the number of peaks,
+//buffers are only reallocated if the number of samples or peaks grows.
+template<typename Model>
+class PsfMultiPeakFit : public AbstractPsfMultiPeakFit
+{
+public:
+	typedef PsfMultiPeakFunctor<Model> FunctorType;
+
+	PsfMultiPeakFit()
+		: size(0),
+		peakCount(0),
+		evaluations(0),
+		cost(std::numeric_limits<double>::infinity()),
+		timeBudgetUs(0),
+		budgetExceeded(false)
+	{
+	}
+
+	void setData(const double* xData, const double* yData, int size) override {
+		if (this->xData.size() < size) {
+			this->xData.resize(size);
+			this->yData.resize(size);
+		}
+		for (int i = 0; i < size; i++) {
+			this->xData[i] = xData[i];
+			this->yData[i] = yData[i];
+		}
+		this->size = size;
+	}
+
+	void setInitialGuess(const PeakFinder::Peak* peaks, int peakCount) override {
+		this->peakCount = peakCount;
+		this->params.resize(1 + peakCount * FunctorType::PeakParameterCount);
+		double baseline = this->size > 0 ? this->yData.head(this->size).minCoeff() : 0.0;
+		this->params[0] = baseline;
+
+		//every peak is estimated relative to the common offset, the peak finder already provides position and width at half prominence
+		typename Model::Params peakParams;
+		for (int j = 0; j < peakCount; j++) {
+			HalfMaximumWidth::Result estimate;
+			estimate.valid = true;
+			estimate.peakPosition = peaks[j].position;
+			estimate.peakValue = peaks[j].value - baseline;
+			estimate.baseline = 0.0;
+			estimate.leftCrossing = peaks[j].leftCrossing;
+			estimate.rightCrossing = peaks[j].rightCrossing;
+			estimate.fwhm = qMax(peaks[j].rightCrossing - peaks[j].leftCrossing, 1e-3);
+			Model::initialGuess(estimate, peakParams);
+			int offset = 1 + j * FunctorType::PeakParameterCount;
+			this->params[offset] = peakParams[0];
+			for (int i = 2; i < Model::ParameterCount; i++) {
+				this->params[offset + i - 1] = peakParams[i];
+			}
+		}
+	}
+
+	void fit() override {
+		FunctorType functor(this->xData.data(), this->yData.data(), this->size, this->peakCount);
+		this->cost = levenbergMarquardt(functor, this->params, this->normalMatrix, this->timeBudgetUs, this->evaluations, this->budgetExceeded);
+	}
+
+	void setTimeBudget(int timeBudgetUs) override { this->timeBudgetUs = timeBudgetUs; }
+
+	void evaluate(const double* x, double* y, int size) const override {
+		FunctorType functor(this->xData.data(), this->yData.data(), this->size, this->peakCount);
+		for (int i = 0; i < size; i++) {
+			y[i] = functor.value(this->params, x[i]);
+		}
+	}
+
+	int getPeakCount() const override { return this->peakCount; }
+
+	double getFWHM(int peak) const override {
+		typename Model::Params peakParams;
+		FunctorType::peakParams(this->params, peak, peakParams);
+		return Model::fwhm(peakParams);
+	}
+
+	double getPeakPosition(int peak) const override {
+		return this->params[1 + peak * FunctorType::PeakParameterCount + 1];
+	}
+
+	int getEvaluations() const override { return this->evaluations; }
+	bool isBudgetExceeded() const override { return this->budgetExceeded; }
+
+	bool isValid() const override {
+		if (this->size <= 0 || this->peakCount <= 0 || !qIsFinite(this->cost) || !this->params.allFinite()) {
+			return false;
+		}
+		for (int j = 0; j < this->peakCount; j++) {
+			double position = this->getPeakPosition(j);
+			if (position < this->xData[0] || position > this->xData[this->size-1]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	FitQuality getQuality(int peak) const override {
+		//fwhm gradient of the peak parameters, k is not part of the single peak model
+		typename Model::Params peakParams;
+		typename Model::Params peakGradient;
+		FunctorType::peakParams(this->params, peak, peakParams);
+		psfModelFwhmGradient<Model>(peakParams, peakGradient);
+		Eigen::VectorXd fwhmGradient = Eigen::VectorXd::Zero(this->params.size());
+		int offset = 1 + peak * FunctorType::PeakParameterCount;
+		fwhmGradient[offset] = peakGradient[0];
+		for (int i = 2; i < Model::ParameterCount; i++) {
+			fwhmGradient[offset + i - 1] = peakGradient[i];
+		}
+		if (this->normalMatrix.rows() != this->params.size()) {
+			return FitQuality();
+		}
+		return FitQuality::calculate(this->normalMatrix, fwhmGradient, offset + 1, this->cost, this->yData.data(), this->size);
+	}
+
+private:
+	Eigen::VectorXd xData;
+	Eigen::VectorXd yData;
+	int size;
+	int peakCount;
+	Eigen::VectorXd params; //k, then all parameters except k of every peak
+	Eigen::MatrixXd normalMatrix; //J^T*J at the fitted parameters
+	int evaluations;
+	double cost;
+	int timeBudgetUs;
+	bool budgetExceeded;
+};
+
+#endif //PSFMULTIPEAKFIT_H
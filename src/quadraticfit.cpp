@@ -0,0 +1,34 @@
+#include "quadraticfit.h"
+#include <QtMath>
+
+
+QuadraticFit::QuadraticFit() {
+	this->reset();
+}
+
+void QuadraticFit::reset() {
+	this->ata.setZero();
+	this->aty.setZero();
+	this->coefficients.setZero();
+	this->points = 0;
+}
+
+void QuadraticFit::addPoint(double x, double y, double weight) {
+	Eigen::Vector3d row(1.0, x, x*x);
+	this->ata.noalias() += weight * row * row.transpose();
+	this->aty.noalias() += weight * y * row;
+	this->points++;
+}
+
+bool QuadraticFit::solve() {
+	//three points are needed to determine a parabola
+	if (this->points < 3) {
+		return false;
+	}
+	Eigen::LDLT<Eigen::Matrix3d> ldlt(this->ata);
+	if (ldlt.info() != Eigen::Success || !ldlt.isPositive() || ldlt.rcond() < 1e-14) {
+		return false;
+	}
+	this->coefficients = ldlt.solve(this->aty);
+	return qIsFinite(this->coefficients[0]) && qIsFinite(this->coefficients[1]) && qIsFinite(this->coefficients[2]);
+}
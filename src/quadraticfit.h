@@ -0,0 +1,32 @@
+#ifndef QUADRATICFIT_H
+#define QUADRATICFIT_H
+
+#include <Eigen/Dense>
+
+//weighted linear least squares fit of the parabola y = c0 + c1*x + c2*x^2.
+//points are accumulated directly into the 3x3 normal equations, so no memory is allocated and no samples need to be stored.
+//x values should be centered (e.g. around the peak position) to keep the normal equations well conditioned.
+class QuadraticFit
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	QuadraticFit();
+
+	void reset();
+	void addPoint(double x, double y, double weight = 1.0);
+	bool solve();
+
+	double getC0() const { return this->coefficients[0]; }
+	double getC1() const { return this->coefficients[1]; }
+	double getC2() const { return this->coefficients[2]; }
+	int getPoints() const { return this->points; }
+
+private:
+	Eigen::Matrix3d ata;
+	Eigen::Vector3d aty;
+	Eigen::Vector3d coefficients;
+	int points;
+};
+
+#endif //QUADRATICFIT_H
@@ -0,0 +1,40 @@
+#include "robustweights.h"
+#include <QtMath>
+#include <algorithm>
+
+
+bool RobustWeights::calculate(ROBUST_LOSS loss, const double* residuals, double* scratch, double* weights, int size) {
+	if (size <= 0) {
+		return false;
+	}
+	if (loss == LEAST_SQUARES_LOSS) {
+		std::fill(weights, weights + size, 1.0);
+		return true;
+	}
+
+	//robust noise scale from the median absolute residual. nth_element is O(n)
+	for (int i = 0; i < size; i++) {
+		scratch[i] = qAbs(residuals[i]);
+	}
+	std::nth_element(scratch, scratch + size/2, scratch + size);
+	double scale = ROBUST_MAD_TO_SIGMA * scratch[size/2];
+	if (!(scale > 0.0) || !qIsFinite(scale)) {
+		return false;
+	}
+
+	if (loss == HUBER_LOSS) {
+		double threshold = ROBUST_HUBER_CONSTANT * scale;
+		for (int i = 0; i < size; i++) {
+			double absResidual = qAbs(residuals[i]);
+			weights[i] = absResidual <= threshold ? 1.0 : threshold / absResidual;
+		}
+	} else {
+		double threshold = ROBUST_TUKEY_CONSTANT * scale;
+		for (int i = 0; i < size; i++) {
+			double u = residuals[i] / threshold;
+			double v = 1.0 - u * u;
+			weights[i] = v > 0.0 ? v * v : 0.0;
+		}
+	}
+	return true;
+}
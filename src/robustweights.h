@@ -0,0 +1,29 @@
+#ifndef ROBUSTWEIGHTS_H
+#define ROBUSTWEIGHTS_H
+
+#include <QtGlobal>
+
+#define ROBUST_HUBER_CONSTANT 1.345 //95 % efficiency for normally distributed residuals
+#define ROBUST_TUKEY_CONSTANT 4.685 //95 % efficiency for normally distributed residuals
+#define ROBUST_MAD_TO_SIGMA 1.4826 //median absolute deviation of normally distributed residuals * this factor = standard deviation
+#define ROBUST_IRLS_MAX_ITERATIONS 3 //reweighting steps after the first (unweighted) fit
+#define ROBUST_IRLS_TOLERANCE 1e-4 //robust reweighting stops if the parameters change less than this (relative)
+
+
+enum ROBUST_LOSS{
+	LEAST_SQUARES_LOSS, //plain least squares, every sample has weight 1
+	HUBER_LOSS, //large residuals get weight c/|u|, i.e. linear instead of quadratic loss
+	TUKEY_LOSS //residuals above c are ignored completely (weight 0), e.g. side lobes and coherence revival ghosts
+};
+
+
+//weights of iteratively reweighted least squares. residuals u are scaled by a robust estimate of the noise (median absolute deviation),
+//so the tuning constants are in units of the noise standard deviation
+class RobustWeights
+{
+public:
+	//scratch needs size elements, it is used to find the median without modifying residuals. returns false if the scale can not be estimated (e.g. all residuals are 0)
+	static bool calculate(ROBUST_LOSS loss, const double* residuals, double* scratch, double* weights, int size);
+};
+
+#endif //ROBUSTWEIGHTS_H
@@ -0,0 +1,86 @@
+#include "roifingerprint.h"
+#include <cstring>
+
+#define ROI_FINGERPRINT_PRIME_1 0x9E3779B185EBCA87ULL
+#define ROI_FINGERPRINT_PRIME_2 0xC2B2AE3D27D4EB4FULL
+#define ROI_FINGERPRINT_PRIME_3 0x165667B19E3779F9ULL
+
+
+static inline quint64 rotateLeft(quint64 value, int bits) {
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static inline quint64 mixLane(quint64 lane, quint64 word) {
+	return rotateLeft(lane + word * ROI_FINGERPRINT_PRIME_2, 31) * ROI_FINGERPRINT_PRIME_1;
+}
+
+//words are read with memcpy, roi lines in the frame are not aligned to 8 bytes
+static inline quint64 readWord(const char* bytes) {
+	quint64 word;
+	memcpy(&word, bytes, sizeof(word));
+	return word;
+}
+
+
+RoiFingerprint::RoiFingerprint(PIXEL_TYPE pixelType, int x, int y, int width)
+	: bytesPerSample(PixelType::bytesPerSample(pixelType)),
+	bytesPerLine(static_cast<size_t>(qMax(0, width)) * PixelType::bytesPerSample(pixelType)),
+	lineCount(0)
+{
+	//geometry of the region is the seed, the number of lines is added by result()
+	this->lanes[0] = mixLane(ROI_FINGERPRINT_PRIME_3, static_cast<quint64>(static_cast<quint32>(x)) << 32 | static_cast<quint32>(y));
+	this->lanes[1] = mixLane(ROI_FINGERPRINT_PRIME_3, static_cast<quint64>(static_cast<quint32>(width)));
+	this->lanes[2] = mixLane(ROI_FINGERPRINT_PRIME_3, static_cast<quint64>(pixelType));
+	this->lanes[3] = ROI_FINGERPRINT_PRIME_1;
+}
+
+void RoiFingerprint::addLines(const void* lines, int stride, int height) {
+	size_t strideBytes = static_cast<size_t>(stride) * this->bytesPerSample;
+	size_t bytesPerLine = this->bytesPerLine;
+
+	//32 bytes per step, the four lanes have no dependency between each other. the remaining bytes of a line are zero padded to one more word
+	quint64 lane0 = this->lanes[0];
+	quint64 lane1 = this->lanes[1];
+	quint64 lane2 = this->lanes[2];
+	quint64 lane3 = this->lanes[3];
+	size_t blockBytes = bytesPerLine & ~static_cast<size_t>(31);
+	for (int line = 0; line < height; line++) {
+		const char* bytes = static_cast<const char*>(lines) + static_cast<size_t>(line)*strideBytes;
+		for (size_t i = 0; i < blockBytes; i += 32) {
+			lane0 = mixLane(lane0, readWord(bytes + i));
+			lane1 = mixLane(lane1, readWord(bytes + i + 8));
+			lane2 = mixLane(lane2, readWord(bytes + i + 16));
+			lane3 = mixLane(lane3, readWord(bytes + i + 24));
+		}
+		for (size_t i = blockBytes; i < bytesPerLine; i += 8) {
+			quint64 word = 0;
+			memcpy(&word, bytes + i, qMin(static_cast<size_t>(8), bytesPerLine - i));
+			lane0 = mixLane(lane0, word);
+		}
+	}
+	this->lanes[0] = lane0;
+	this->lanes[1] = lane1;
+	this->lanes[2] = lane2;
+	this->lanes[3] = lane3;
+	this->lineCount += static_cast<quint64>(qMax(0, height));
+}
+
+quint64 RoiFingerprint::result() const {
+	//merge lanes and avalanche the result, so every input bit changes about half of the output bits
+	quint64 hash = rotateLeft(this->lanes[0], 1) + rotateLeft(this->lanes[1], 7) + rotateLeft(this->lanes[2], 12) + rotateLeft(this->lanes[3], 18);
+	hash ^= this->lineCount * ROI_FINGERPRINT_PRIME_3;
+	hash ^= hash >> 33;
+	hash *= ROI_FINGERPRINT_PRIME_2;
+	hash ^= hash >> 29;
+	hash *= ROI_FINGERPRINT_PRIME_3;
+	hash ^= hash >> 32;
+	return hash == ROI_FINGERPRINT_NONE ? 1 : hash;
+}
+
+quint64 RoiFingerprint::calculate(const void* frame, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height) {
+	size_t bytesPerSample = PixelType::bytesPerSample(pixelType);
+	const char* region = &static_cast<const char*>(frame)[(static_cast<size_t>(y)*static_cast<size_t>(stride) + static_cast<size_t>(x))*bytesPerSample];
+	RoiFingerprint fingerprint(pixelType, x, y, width);
+	fingerprint.addLines(region, stride, height);
+	return fingerprint.result();
+}
@@ -0,0 +1,36 @@
+#ifndef ROIFINGERPRINT_H
+#define ROIFINGERPRINT_H
+
+#include <QtGlobal>
+#include "pixeltype.h"
+
+#define ROI_FINGERPRINT_NONE 0 //fingerprint of a frame slot for which no fingerprint was calculated
+
+
+//64 bit hash of the samples of a rectangular region of a frame, used to detect frames that are fetched again without any change (paused acquisition, frozen display).
+//every line of the region is hashed as 64 bit words in four independent lanes (multiply and rotate), so the hash runs at memory speed and misses no changed sample.
+//position within the frame, size and pixel type of the region are part of the hash, the same data at a different roi gives a different fingerprint.
+//the lines can be added block by block while they are copied or reduced anyway, so hashing needs no separate pass over the region
+class RoiFingerprint
+{
+public:
+	//x and y are the position of the region within the frame, also if the lines are hashed from a compact copy of the region
+	RoiFingerprint(PIXEL_TYPE pixelType, int x, int y, int width);
+
+	//hashes the next height lines of the region. lines points to the first sample of the region in the first of these lines, stride is the number of samples per line
+	void addLines(const void* lines, int stride, int height);
+
+	//hash of all lines added so far, the number of lines is part of it. never returns ROI_FINGERPRINT_NONE
+	quint64 result() const;
+
+	//hash of lines y to y+height-1 and samples x to x+width-1 of frame. stride is the number of samples per line in frame
+	static quint64 calculate(const void* frame, PIXEL_TYPE pixelType, int stride, int x, int y, int width, int height);
+
+private:
+	quint64 lanes[4];
+	size_t bytesPerSample;
+	size_t bytesPerLine;
+	quint64 lineCount;
+};
+
+#endif //ROIFINGERPRINT_H
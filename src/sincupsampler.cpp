@@ -0,0 +1,129 @@
+#include "sincupsampler.h"
+#include <QtMath>
+
+
+SincUpsampler::SincUpsampler() {
+	this->forwardPlan.size = 0;
+	this->inversePlan.size = 0;
+}
+
+bool SincUpsampler::isValidFactor(int factor) {
+	return factor >= 1 && factor <= SINC_UPSAMPLER_MAX_FACTOR && (factor & (factor-1)) == 0;
+}
+
+bool SincUpsampler::upsample(const double* x, const double* y, int size, int factor, QVector<double>& xOut, QVector<double>& yOut) {
+	if (size < 2 || !isValidFactor(factor)) {
+		return false;
+	}
+
+	//smallest power of two that holds the window. the padded samples are 0, like the ends of the detrended window
+	int fftSize = 1;
+	while (fftSize < size) {
+		fftSize *= 2;
+	}
+	int paddedSize = fftSize * factor;
+	if (this->forwardPlan.size != fftSize) {
+		preparePlan(this->forwardPlan, fftSize);
+	}
+	if (this->inversePlan.size != paddedSize) {
+		preparePlan(this->inversePlan, paddedSize);
+	}
+	if (this->spectrum.size() < fftSize) {
+		this->spectrum.resize(fftSize);
+	}
+	if (this->paddedSpectrum.size() < paddedSize) {
+		this->paddedSpectrum.resize(paddedSize);
+	}
+
+	//remove linear trend between first and last sample
+	double offset = y[0];
+	double slope = (y[size-1] - y[0]) / (size-1);
+	Complex* data = this->spectrum.data();
+	for (int i = 0; i < size; i++) {
+		data[i] = Complex(y[i] - offset - slope*i, 0.0);
+	}
+	for (int i = size; i < fftSize; i++) {
+		data[i] = Complex(0.0, 0.0);
+	}
+	transform(this->forwardPlan, data, false);
+
+	//zero padding in the middle of the spectrum. the Nyquist bin is split between positive and negative frequency, so the result stays real
+	Complex* padded = this->paddedSpectrum.data();
+	int half = fftSize / 2;
+	for (int i = 0; i < paddedSize; i++) {
+		padded[i] = Complex(0.0, 0.0);
+	}
+	for (int i = 0; i < half; i++) {
+		padded[i] = data[i];
+	}
+	for (int i = half+1; i < fftSize; i++) {
+		padded[paddedSize - fftSize + i] = data[i];
+	}
+	if (fftSize > 1 && factor > 1) {
+		padded[half] = 0.5 * data[half];
+		padded[paddedSize - half] = 0.5 * data[half];
+	} else {
+		padded[half] = data[half];
+	}
+	transform(this->inversePlan, padded, true);
+
+	//inverse transform is not normalized: 1/fftSize for the forward/inverse pair. trend is added again
+	int outputSize = (size-1) * factor + 1;
+	double spacing = (x[size-1] - x[0]) / (size-1);
+	double scale = 1.0 / fftSize;
+	xOut.resize(outputSize);
+	yOut.resize(outputSize);
+	for (int i = 0; i < outputSize; i++) {
+		double position = static_cast<double>(i) / factor;
+		xOut[i] = x[0] + position * spacing;
+		yOut[i] = padded[i].real() * scale + offset + slope * position;
+	}
+	return true;
+}
+
+void SincUpsampler::preparePlan(Plan& plan, int size) {
+	plan.size = size;
+	plan.twiddles.resize(qMax(1, size/2));
+	for (int k = 0; k < size/2; k++) {
+		double angle = -2.0 * M_PI * k / size;
+		plan.twiddles[k] = Complex(qCos(angle), qSin(angle));
+	}
+	plan.bitReverse.resize(size);
+	int bits = 0;
+	while ((1 << bits) < size) {
+		bits++;
+	}
+	for (int i = 0; i < size; i++) {
+		int reversed = 0;
+		for (int b = 0; b < bits; b++) {
+			if (i & (1 << b)) {
+				reversed |= 1 << (bits-1-b);
+			}
+		}
+		plan.bitReverse[i] = reversed;
+	}
+}
+
+void SincUpsampler::transform(const Plan& plan, Complex* data, bool inverse) {
+	//iterative radix-2 decimation in time. the inverse transform uses the conjugated twiddle factors and is not normalized
+	int size = plan.size;
+	for (int i = 0; i < size; i++) {
+		int j = plan.bitReverse.at(i);
+		if (j > i) {
+			std::swap(data[i], data[j]);
+		}
+	}
+	const Complex* twiddles = plan.twiddles.constData();
+	for (int length = 2; length <= size; length *= 2) {
+		int halfLength = length / 2;
+		int twiddleStride = size / length;
+		for (int start = 0; start < size; start += length) {
+			for (int k = 0; k < halfLength; k++) {
+				Complex twiddle = inverse ? std::conj(twiddles[k*twiddleStride]) : twiddles[k*twiddleStride];
+				Complex odd = twiddle * data[start + k + halfLength];
+				data[start + k + halfLength] = data[start + k] - odd;
+				data[start + k] += odd;
+			}
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef SINCUPSAMPLER_H
+#define SINCUPSAMPLER_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <complex>
+
+#define SINC_UPSAMPLER_MAX_FACTOR 16
+
+
+//band-limited (sinc) interpolation of a line by zero padding its spectrum. only the roi window is transformed with a small radix-2 FFT.
+//a linear trend between the first and the last sample is removed before the transform and added again afterwards, so the periodic continuation
+//of the window has no jump that would cause ringing. twiddle factors and bit reversal tables of the last sizes are kept for the next frame,
+//buffers only grow, so a SincUpsampler that is reused for every frame does not allocate heap memory.
+class SincUpsampler
+{
+public:
+	SincUpsampler();
+
+	static bool isValidFactor(int factor); //power of two from 1 (no upsampling) to SINC_UPSAMPLER_MAX_FACTOR
+
+	//x values must be equally spaced and increasing. xOut and yOut get (size-1)*factor+1 samples that start at x[0] and end at x[size-1]
+	bool upsample(const double* x, const double* y, int size, int factor, QVector<double>& xOut, QVector<double>& yOut);
+
+private:
+	typedef std::complex<double> Complex;
+
+	//precomputed tables of one transform size
+	struct Plan {
+		int size;
+		QVector<Complex> twiddles; //exp(-2*pi*i*k/size) for k < size/2
+		QVector<int> bitReverse;
+	};
+
+	static void preparePlan(Plan& plan, int size);
+	static void transform(const Plan& plan, Complex* data, bool inverse);
+
+	Plan forwardPlan;
+	Plan inversePlan;
+	QVector<Complex> spectrum;
+	QVector<Complex> paddedSpectrum;
+};
+
+#endif //SINCUPSAMPLER_H
@@ -0,0 +1,78 @@
+#include "temporalaverage.h"
+
+
+TemporalAverage::TemporalAverage()
+	: frameCount(1),
+	size(0),
+	filledFrames(0),
+	nextFrame(0)
+{
+
+}
+
+void TemporalAverage::setFrameCount(int frames) {
+	frames = qBound(1, frames, TEMPORAL_AVERAGE_MAX_FRAMES);
+	if (frames == this->frameCount) {
+		return;
+	}
+	this->frameCount = frames;
+	this->reset();
+}
+
+void TemporalAverage::reset() {
+	this->filledFrames = 0;
+	this->nextFrame = 0;
+	this->sum.fill(0.0, this->size);
+}
+
+void TemporalAverage::add(const double* line, int size, double* average) {
+	if (size <= 0) {
+		return;
+	}
+	//ring memory only grows, a smaller roi uses the beginning of each ring entry
+	if (size != this->size) {
+		this->size = size;
+		this->reset();
+	}
+	int capacity = this->frameCount * size;
+	if (this->ring.size() < capacity) {
+		this->ring.resize(capacity);
+	}
+
+	//replace oldest line of the window by the new one and update the sum
+	double* slot = this->ring.data() + static_cast<size_t>(this->nextFrame) * size;
+	double* sum = this->sum.data();
+	bool windowFilled = this->filledFrames == this->frameCount;
+	for (int i = 0; i < size; i++) {
+		if (windowFilled) {
+			sum[i] -= slot[i];
+		}
+		sum[i] += line[i];
+		slot[i] = line[i];
+	}
+	if (!windowFilled) {
+		this->filledFrames++;
+	}
+	this->nextFrame = (this->nextFrame + 1) % this->frameCount;
+	if (this->nextFrame == 0 && windowFilled) {
+		this->recalculateSum();
+	}
+
+	double scale = 1.0 / this->filledFrames;
+	for (int i = 0; i < size; i++) {
+		average[i] = sum[i] * scale;
+	}
+}
+
+void TemporalAverage::recalculateSum() {
+	double* sum = this->sum.data();
+	for (int i = 0; i < this->size; i++) {
+		sum[i] = 0.0;
+	}
+	for (int frame = 0; frame < this->filledFrames; frame++) {
+		const double* line = this->ring.constData() + static_cast<size_t>(frame) * this->size;
+		for (int i = 0; i < this->size; i++) {
+			sum[i] += line[i];
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#ifndef TEMPORALAVERAGE_H
+#define TEMPORALAVERAGE_H
+
+#include <QtGlobal>
+#include <QVector>
+
+#define TEMPORAL_AVERAGE_MAX_FRAMES 256
+
+
+//sliding window average of the last n averaged lines (e.g. the roi part of the averaged A-scan of the last n fetched frames).
+//the lines are kept in a ring and their sum is updated incrementally: the newest line is added, the line that drops out of the window is subtracted.
+//adding a line costs O(line length) independent of n. the sum is recalculated from the ring once per pass through the ring, so rounding errors
+//of the incremental updates can not accumulate.
+class TemporalAverage
+{
+public:
+	TemporalAverage();
+
+	void setFrameCount(int frames); //length of the window, clamped to 1..TEMPORAL_AVERAGE_MAX_FRAMES. a different length resets the average
+	int getFrameCount() const { return this->frameCount; }
+	int getAveragedFrames() const { return this->filledFrames; } //number of lines in the window, smaller than the frame count until the window is filled
+	void reset();
+
+	//adds line to the window and writes the mean of all lines in the window to average (may be the same memory as line). a different size resets the average
+	void add(const double* line, int size, double* average);
+
+private:
+	void recalculateSum();
+
+	int frameCount;
+	int size;
+	int filledFrames;
+	int nextFrame; //ring index that is overwritten by the next line
+	QVector<double> ring; //frameCount lines of size samples
+	QVector<double> sum;
+};
+
+#endif //TEMPORALAVERAGE_H